@@ -0,0 +1,311 @@
+// Command line client of the control server (SimTeach --serve <socket>), runs the commands in
+// order and prints the replies, with streamed channels as csv
+#include "Protocol.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+constexpr std::string_view usage =
+    "Usage: SimTeachClient <socket> <commands...>\n"
+    "  load <scene.csv>             gravity <g>                 step-size <seconds>\n"
+    "  point <id> <pos.x|pos.y|vel.x|vel.y|mass|fixed> <value>\n"
+    "  spring <id> <k|length|damping> <value>\n"
+    "  graph <point|spring> <id> <position|velocity|length|extension|force> <x|y|mag>\n"
+    "  start    stop    step <n>    status    shutdown\n"
+    "  subscribe <steps per sample> <batches per second> [energy]    unsubscribe\n"
+    "  watch <seconds>              prints the streamed samples\n";
+
+class Connection {
+  public:
+    explicit Connection(int fd_) : fd(fd_) {}
+    ~Connection() { ::close(fd); }
+    Connection(const Connection& other)            = delete;
+    Connection& operator=(const Connection& other) = delete;
+
+    bool send(const std::vector<std::byte>& message) {
+        std::size_t sent = 0;
+        while (sent < message.size()) {
+            const ssize_t n = ::send(fd, message.data() + sent, message.size() - sent, 0);
+            if (n <= 0) return false;
+            sent += static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    // waits up to timeoutMs (forever if negative) for a message, false if the server is gone or
+    // the time ran out (timedOut tells which)
+    bool receive(MessageHeader& header, std::vector<std::byte>& payload, int timeoutMs,
+                 bool& timedOut) {
+        timedOut = false;
+        while (true) {
+            const std::optional<MessageHeader> complete = completeMessage(in.data(), in.size());
+            if (complete) {
+                if (complete->size > maxPayload) return false;
+                header = *complete;
+                const auto* begin = in.data() + sizeof(MessageHeader);
+                payload.assign(begin, begin + header.size);
+                in.erase(in.begin(), in.begin() + static_cast<std::ptrdiff_t>(
+                                                      sizeof(MessageHeader) + header.size));
+                return true;
+            }
+            pollfd waiting{fd, POLLIN, 0};
+            const int ready = ::poll(&waiting, 1, timeoutMs);
+            if (ready == 0) {
+                timedOut = true;
+                return false;
+            }
+            std::array<std::byte, 1U << 16> buffer;
+            const ssize_t                   n = ::recv(fd, buffer.data(), buffer.size(), 0);
+            if (ready < 0 || n <= 0) return false;
+            in.insert(in.end(), buffer.begin(), buffer.begin() + n);
+        }
+    }
+
+  private:
+    int                    fd;
+    std::vector<std::byte> in;
+};
+
+std::optional<int> connectTo(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return std::nullopt;
+    std::copy(path.begin(), path.end(), address.sun_path);
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return std::nullopt;
+    if (::connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd);
+        return std::nullopt;
+    }
+    return fd;
+}
+
+template <typename T>
+std::optional<T> parse(std::string_view text) {
+    T value{};
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc{} || end != text.data() + text.size()) return std::nullopt;
+    return value;
+}
+
+template <std::size_t N>
+std::optional<std::uint8_t> lookup(std::string_view name,
+                                   const std::array<std::string_view, N>& names) {
+    for (std::size_t i = 0; i < N; ++i)
+        if (names[i] == name) return static_cast<std::uint8_t>(i);
+    return std::nullopt;
+}
+
+// the enum order in Protocol.hpp and Graph.hpp
+constexpr std::array<std::string_view, 6> pointFields{"pos.x", "pos.y", "vel.x",
+                                                      "vel.y", "mass",  "fixed"};
+constexpr std::array<std::string_view, 3> springFields{"k", "length", "damping"};
+constexpr std::array<std::string_view, 2> objectTypes{"point", "spring"};
+constexpr std::array<std::string_view, 5> properties{"position", "velocity", "length",
+                                                     "extension", "force"};
+constexpr std::array<std::string_view, 3> components{"x", "y", "mag"};
+
+// prints a message that isn't the reply being waited for
+void print(const MessageHeader& header, const std::vector<std::byte>& payload) {
+    MessageReader reader(payload.data(), payload.size());
+    switch (static_cast<Reply>(header.type)) {
+    case Reply::Channels: {
+        const auto count = reader.get<std::uint32_t>();
+        std::cout << "time";
+        for (std::uint32_t i = 0; i < count && reader.ok(); ++i)
+            std::cout << "," << reader.getString();
+        std::cout << "\n";
+        break;
+    }
+    case Reply::Frames: {
+        const auto rows    = reader.get<std::uint32_t>();
+        const auto columns = reader.get<std::uint32_t>();
+        const auto dropped = reader.get<std::uint64_t>();
+        if (dropped != 0) std::cerr << "(" << dropped << " rows dropped)\n";
+        for (std::uint32_t r = 0; r < rows && reader.ok(); ++r) {
+            std::cout << reader.get<double>();
+            for (std::uint32_t c = 0; c < columns; ++c) std::cout << "," << reader.get<float>();
+            std::cout << "\n";
+        }
+        break;
+    }
+    case Reply::Status: {
+        const auto time    = reader.get<double>();
+        const auto steps   = reader.get<std::uint64_t>();
+        const auto running = reader.get<std::uint8_t>() != 0;
+        const auto points  = reader.get<std::uint64_t>();
+        const auto springs = reader.get<std::uint64_t>();
+        std::cout << "time " << time << ", " << steps << " steps, "
+                  << (running ? "running" : "stopped") << ", " << points << " points, " << springs
+                  << " springs\n";
+        break;
+    }
+    case Reply::Ack:
+        break; // handled by the caller
+    }
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cout << usage;
+        return 1;
+    }
+    const std::optional<int> fd = connectTo(argv[1]);
+    if (!fd) {
+        std::cout << "Failed to connect to " << argv[1] << "\n";
+        return 1;
+    }
+    Connection connection(*fd);
+
+    std::vector<std::byte> payload;
+    MessageHeader          header{};
+    bool                   timedOut = false;
+    bool                   failed   = false;
+
+    const std::vector<std::string_view> args(argv + 2, argv + argc);
+    for (std::size_t i = 0; i < args.size(); ++i) {
+        const std::string_view command = args[i];
+        // the ith argument after the command, empty if missing
+        auto argAt = [&](std::size_t offset) {
+            return i + offset < args.size() ? args[i + offset] : std::string_view{};
+        };
+
+        std::vector<std::byte> message;
+        MessageWriter          writer(message);
+        std::optional<Request> request;
+        std::size_t            used = 0; // arguments taken by the command
+
+        if (command == "load") {
+            request = Request::Load;
+            writer.begin(*request).put(argAt(1));
+            used = 1;
+        } else if (command == "gravity") {
+            const auto g = parse<double>(argAt(1));
+            if (g) writer.begin(*(request = Request::SetGravity)).put(*g);
+            used = 1;
+        } else if (command == "step-size") {
+            const auto step = parse<double>(argAt(1));
+            if (step) writer.begin(*(request = Request::SetStep)).put(*step);
+            used = 1;
+        } else if (command == "point") {
+            const auto id    = parse<std::uint64_t>(argAt(1));
+            const auto field = lookup(argAt(2), pointFields);
+            const auto value = parse<double>(argAt(3));
+            if (id && field && value)
+                writer.begin(*(request = Request::SetPoint)).put(*id).put(*field).put(*value);
+            used = 3;
+        } else if (command == "spring") {
+            const auto id    = parse<std::uint64_t>(argAt(1));
+            const auto field = lookup(argAt(2), springFields);
+            const auto value = parse<double>(argAt(3));
+            if (id && field && value)
+                writer.begin(*(request = Request::SetSpring)).put(*id).put(*field).put(*value);
+            used = 3;
+        } else if (command == "graph") {
+            const auto type = lookup(argAt(1), objectTypes);
+            const auto id   = parse<std::uint64_t>(argAt(2));
+            const auto prop = lookup(argAt(3), properties);
+            const auto comp = lookup(argAt(4), components);
+            if (type && id && prop && comp)
+                writer.begin(*(request = Request::AddGraph)).put(*type).put(*id).put(*prop).put(
+                    *comp);
+            used = 4;
+        } else if (command == "start") {
+            writer.begin(*(request = Request::Start));
+        } else if (command == "stop") {
+            writer.begin(*(request = Request::Stop));
+        } else if (command == "step") {
+            const auto steps = parse<std::uint64_t>(argAt(1));
+            if (steps) writer.begin(*(request = Request::Step)).put(*steps);
+            used = 1;
+        } else if (command == "subscribe") {
+            const auto every  = parse<std::uint32_t>(argAt(1));
+            const auto rate   = parse<double>(argAt(2));
+            const bool energy = argAt(3) == "energy";
+            if (every && rate)
+                writer.begin(*(request = Request::Subscribe))
+                    .put(*every)
+                    .put(*rate)
+                    .put(static_cast<std::uint8_t>(energy));
+            used = energy ? 3 : 2;
+        } else if (command == "unsubscribe") {
+            writer.begin(*(request = Request::Unsubscribe));
+        } else if (command == "status") {
+            writer.begin(*(request = Request::Status));
+        } else if (command == "shutdown") {
+            writer.begin(*(request = Request::Shutdown));
+        } else if (command == "watch") {
+            const auto seconds = parse<double>(argAt(1));
+            if (!seconds) {
+                std::cout << "watch needs a duration in seconds\n" << usage;
+                return 1;
+            }
+            using namespace std::chrono;
+            const steady_clock::time_point end =
+                steady_clock::now() + duration_cast<nanoseconds>(duration<double>(*seconds));
+            while (true) {
+                const auto left = duration_cast<milliseconds>(end - steady_clock::now()).count();
+                if (left <= 0) break;
+                if (!connection.receive(header, payload, static_cast<int>(left), timedOut)) {
+                    if (timedOut) break;
+                    std::cout << "The server closed the connection\n";
+                    return 1;
+                }
+                print(header, payload);
+            }
+            i += 1;
+            continue;
+        } else {
+            std::cout << "Unknown command " << command << "\n" << usage;
+            return 1;
+        }
+        if (!request) {
+            std::cout << "Bad arguments for " << command << "\n" << usage;
+            return 1;
+        }
+        writer.finish();
+        i += used;
+
+        if (!connection.send(message)) {
+            std::cout << "The server closed the connection\n";
+            return 1;
+        }
+        // streamed messages can come first
+        const auto expected = *request == Request::Status ? Reply::Status : Reply::Ack;
+        while (true) {
+            if (!connection.receive(header, payload, -1, timedOut)) {
+                if (*request == Request::Shutdown) return failed ? 1 : 0;
+                std::cout << "The server closed the connection\n";
+                return 1;
+            }
+            if (static_cast<Reply>(header.type) == expected) break;
+            print(header, payload);
+        }
+        if (expected == Reply::Status) {
+            print(header, payload);
+            continue;
+        }
+        MessageReader reader(payload.data(), payload.size());
+        reader.get<std::uint16_t>();
+        const bool        ok   = reader.get<std::uint8_t>() != 0;
+        const std::string text = reader.getString();
+        std::cout << command << ": " << text << "\n";
+        if (!ok) failed = true;
+    }
+    return failed ? 1 : 0;
+}
@@ -1,16 +1,32 @@
 #include <array>
 #include <chrono>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "Allocations.hpp"
+#include "ControlServer.hpp"
 #include "EntityManager.hpp"
+#include "FrameArena.hpp"
 #include "Fundamentals/RingBuffer.hpp"
 #include "Fundamentals/Vector2.hpp"
 #include "GUI.hpp"
+#include "History.hpp"
+#include "Renumber.hpp"
+#include "RunClock.hpp"
 #include "SFML/Graphics.hpp"
 #include "SFML/Window.hpp"
 #include "Sim.hpp"
+#include "Solver.hpp"
+#include "StateHash.hpp"
+#include "StatePublisher.hpp"
 #include "Tools/Tools.hpp"
+#include "Trace.hpp"
+#include "Trajectory.hpp"
 #include "imgui-SFML.h"
 #include "imgui.h"
 
@@ -24,7 +40,138 @@ Vec2 unvisualize(const sf::Vector2f& v) { return Vec2(v.x, -v.y); }
 
 Vec2 unvisualize(const sf::Vector2i& v) { return Vec2(v.x, -v.y); }
 
-int main() {
+// headless run of a scene with every integrator, for comparing builds (see Precision.hpp).
+// Every integrator is given the same sim time, calls of callStep seconds, and rated by the
+// integration steps it actually took. With checkAllocations every frameCalls calls make a frame
+// which mustn't allocate after warmup (as --check-allocations checks in the window), returns the
+// number of frames which did. A frame also records history and builds the graphs and the GUI
+// with every panel open, through imgui without a backend and a window that is never opened (so
+// nothing is drawn), the timings then include it.
+std::size_t bench(const std::filesystem::path& scene, std::size_t calls, bool checkAllocations) {
+    constexpr double      callStep   = 0.0001;
+    constexpr std::size_t frameCalls = 100;
+    std::cout << "Benchmarking " << scene << " for " << static_cast<double>(calls) * callStep
+              << " s of sim time, " << precisionLbl << " precision\n";
+    sf::RenderWindow window;
+    if (checkAllocations) {
+        ImGui::CreateContext();
+        ImPlot::CreateContext();
+        ImGuiIO& io    = ImGui::GetIO();
+        io.DisplaySize = {1920.0F, 1080.0F};
+        io.DeltaTime   = 1.0F / 60.0F;
+        io.IniFilename = nullptr;
+        unsigned char* atlas       = nullptr;
+        int            atlasWidth  = 0;
+        int            atlasHeight = 0;
+        io.Fonts->GetTexDataAsRGBA32(&atlas, &atlasWidth, &atlasHeight); // builds the font atlas
+    }
+    std::size_t badFrames = 0;
+    for (std::size_t i = 0; i != IntegratorLbl.size(); ++i) {
+        EntityManager      entities;
+        Sim                sim(entities, 2.0F);
+        Solver             solver(entities);
+        GraphManager       graphs{entities};
+        GUI                gui(entities, sf::VideoMode(1920, 1080), window);
+        RunClock           runClock;
+        History            history;
+        TrajectoryRecorder recorder;
+        sim.load(scene, true, {true, true, true});
+        solver.integrator = static_cast<Integrator>(i);
+        graphs.reset(sim.gravity);
+        gui.openPanels         = true;
+        gui.allocations.warmup = 10;
+        gui.allocations.check  = checkAllocations;
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::size_t                                 steps = 0;
+        for (std::size_t call = 0; call != calls; ++call) {
+            if (checkAllocations && call % frameCalls == 0) {
+                gui.allocations.frameStart();
+                frameArena.reset();
+            }
+            steps += solver.step(sim, callStep);
+            runClock.simTime += callStep;
+            if (checkAllocations && (call + 1) % frameCalls == 0) {
+                const std::uint64_t beforeHistory = threadAllocationCount();
+                history.record(runClock.simTime, entities);
+                gui.allocations.storage(threadAllocationCount() - beforeHistory);
+                ImGui::NewFrame();
+                graphs.updateDraw(static_cast<float>(runClock.simTime), sim.gravity);
+                gui.frame({0, 0}, sim, solver, graphs, runClock, history, recorder, true);
+                ImGui::Render();
+                gui.allocations.frameEnd(true);
+            }
+        }
+        const std::chrono::duration<double> taken = std::chrono::steady_clock::now() - start;
+
+        const double simulated = static_cast<double>(calls) * callStep - solver.owed();
+        std::cout << IntegratorLbl[i] << ": " << steps << " steps ("
+                  << static_cast<double>(steps) / taken.count() << " steps/s), " << simulated
+                  << " s simulated in " << taken.count() << " s, state hash " << std::hex
+                  << stateHash(entities) << std::dec << "\n";
+        badFrames += gui.allocations.badFrames;
+    }
+    if (checkAllocations) {
+        ImPlot::DestroyContext();
+        ImGui::DestroyContext();
+        std::cout << badFrames << " steady state frames allocated\n";
+    }
+    return badFrames;
+}
+
+// headless session driven over a unix socket, see ControlServer.hpp (and app/client.cpp)
+int serve(const std::filesystem::path& socket) {
+    EntityManager entities;
+    Sim           sim(entities, 2.0F);
+    Solver        solver(entities);
+    GraphManager  graphs{entities};
+    ControlServer server(entities, sim, solver, graphs);
+    if (!server.open(socket)) return 1;
+    server.run();
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // command line
+    std::optional<std::filesystem::path> traceFile;
+    std::chrono::nanoseconds             traceLength{0}; // 0 = until exit
+    std::optional<std::filesystem::path> benchScene;
+    std::size_t                          benchSteps       = 10000;
+    bool                                 checkAllocations = false;
+    std::optional<std::string>           publishName;
+    std::optional<std::filesystem::path> serveSocket;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        if (arg == "--trace" && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (arg == "--trace-seconds" && i + 1 < argc) {
+            traceLength = std::chrono::nanoseconds{
+                static_cast<std::int64_t>(std::stod(argv[++i]) * 1e9)};
+        } else if (arg == "--bench" && i + 1 < argc) {
+            benchScene = argv[++i];
+        } else if (arg == "--bench-steps" && i + 1 < argc) {
+            benchSteps = std::stoul(argv[++i]);
+        } else if (arg == "--check-allocations") {
+            checkAllocations = true;
+        } else if (arg == "--publish" && i + 1 < argc) {
+            publishName = argv[++i];
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serveSocket = argv[++i];
+        } else {
+            std::cout << "Usage: " << argv[0]
+                      << " [--trace <file.json> [--trace-seconds <s>]]"
+                         " [--bench <scene.csv> [--bench-steps <n>]] [--check-allocations]"
+                         " [--publish </shared-memory-name>] [--serve <socket>]\n";
+            return 1;
+        }
+    }
+    // with --check-allocations the bench fails on steady state allocations, without a window
+    if (benchScene) return bench(*benchScene, benchSteps, checkAllocations) == 0 ? 0 : 1;
+    if (serveSocket) return serve(*serveSocket);
+    Trace::nameThread("main");
+    const std::chrono::steady_clock::time_point traceStart = std::chrono::steady_clock::now();
+    if (traceFile) Trace::start();
+
     // SFML
     sf::VideoMode       desktop = sf::VideoMode::getDesktopMode();
     sf::ContextSettings settings;
@@ -42,9 +189,15 @@ int main() {
     EntityManager entities;
 
     GUI          gui(entities, desktop, window, 0.05F);
+    gui.allocations.check = checkAllocations;
     GraphManager graphs{entities};
 
-    Sim sim(entities, 2.0F);
+    Sim                sim(entities, 2.0F);
+    Solver             solver(entities);
+    History            history;
+    TrajectoryRecorder recorder;
+    StatePublisher     publisher; // live state for other processes (--publish)
+    if (publishName) publisher.open(*publishName);
 
     std::size_t                        selectedTool = 0;
     std::vector<std::unique_ptr<Tool>> tools;
@@ -53,31 +206,103 @@ int main() {
     tools.push_back(std::make_unique<PolyTool>(window, entities, "Polys"));
     tools.push_back(std::make_unique<GraphTool>(window, entities, graphs, "Graphs"));
 
+    // keeps points joined by springs close together in memory
+    auto renumber = [&] {
+        if (!entities.autoRenumber) return;
+        TraceSpan         span("renumber");
+        const Renumbering renumbering = cuthillMcKee(entities.points, entities.springs);
+        if (renumbering.isIdentity()) return;
+        entities.renumber(renumbering);
+        for (const std::unique_ptr<Tool>& tool: tools) tool->renumber(renumbering);
+        history.clear(); // recorded in the old order
+    };
+
     bool                                  running = false;
-    std::chrono::system_clock::time_point runtime;
+    RunClock                              runClock;
+
+    auto stopRun = [&] {
+        running = false;
+        solver.grab.release();
+        if (runClock.deterministic)
+            std::cout << "State hash after " << runClock.steps << " steps (" << runClock.simTime
+                      << " s): " << std::hex << stateHash(entities) << std::dec << "\n";
+    };
+    // the cursor is sampled between sim steps (at most every ms) instead of once per visual
+    // frame, so a grabbed point follows it while thousands of steps run in a frame
+    constexpr double grabSampleInterval = 0.001;
+    double           lastGrabSample     = 0.0;
+
+    // dragging with the left mouse button while running pulls the closest point (within
+    // grabPixels of the press) towards the cursor
+    constexpr float grabPixels = 30.0F;
+
+    auto grabEvent = [&](const sf::Event& event) {
+        if (event.type == sf::Event::MouseButtonPressed &&
+            event.mouseButton.button == sf::Mouse::Left && !imguIO.WantCaptureMouse &&
+            !entities.points.empty()) {
+            const sf::Vector2i press{event.mouseButton.x, event.mouseButton.y};
+            const Vec2         at    = unvisualize(window.mapPixelToCoords(press));
+            const PointId      point = sim.findClosestPoint(at).first;
+            const sf::Vector2i diff =
+                window.mapCoordsToPixel(
+                    visualize(entities.points[static_cast<std::size_t>(point)].pos)) -
+                press;
+            if (std::hypot(static_cast<float>(diff.x), static_cast<float>(diff.y)) <= grabPixels) {
+                solver.grab.pick(point, at, runClock.wallTime);
+                lastGrabSample = runClock.wallTime;
+            }
+        } else if (event.type == sf::Event::MouseButtonReleased &&
+                   event.mouseButton.button == sf::Mouse::Left) {
+            solver.grab.release();
+        }
+    };
+
+    auto sampleGrab = [&] {
+        if (!solver.grab.grabbed() || runClock.wallTime - lastGrabSample < grabSampleInterval)
+            return;
+        lastGrabSample = runClock.wallTime;
+        solver.grab.moveTo(unvisualize(window.mapPixelToCoords(sf::Mouse::getPosition(window))),
+                           runClock.wallTime);
+    };
+
     std::chrono::system_clock::time_point last =
         std::chrono::high_resolution_clock::now(); // setting time of previous frame to be now
     sf::Clock
         deltaClock; // for imgui - read https://eliasdaler.github.io/using-imgui-with-sfml-pt1/
     while (window.isOpen()) {
         std::chrono::system_clock::time_point start = std::chrono::high_resolution_clock::now();
+        TraceSpan                             vFrameSpan("visual frame");
+        gui.allocations.frameStart();
+        frameArena.reset();
 
         // run the sim
-        int                      simFrames   = 0;
+        std::size_t              simFrames   = 0;
         std::chrono::nanoseconds sinceVFrame = std::chrono::high_resolution_clock::now() - start;
         if (running) {
-            while (sinceVFrame.count() < 10'000'000) {
-                ++simFrames;
+            TraceSpan simSpan("sim steps");
+            while (sinceVFrame.count() < 10'000'000 && !runClock.finished()) {
                 std::chrono::system_clock::time_point frameTime =
                     std::chrono::high_resolution_clock::now();
-                constexpr std::chrono::nanoseconds maxFrame{1'000'000}; // 1 milisecond
-                std::chrono::nanoseconds           deltaTime = std::min(frameTime - last, maxFrame);
-                last                                         = frameTime;
+                const double wallDelta = static_cast<double>((frameTime - last).count()) / 1e9;
+                last                   = frameTime;
+                runClock.wallTime += wallDelta;
+                sampleGrab();
 
-                sim.simFrame(static_cast<double>(deltaTime.count()) / 1e9);
+                if (runClock.due()) {
+                    const double deltaTime = runClock.delta(wallDelta);
+                    simFrames += solver.step(sim, deltaTime);
+                    runClock.simTime += deltaTime;
+                    recorder.record(runClock.simTime, entities);
+                }
                 sinceVFrame = frameTime - start;
             }
+            runClock.steps += simFrames;
+            const std::uint64_t beforeHistory = threadAllocationCount();
+            history.record(runClock.simTime, entities);
+            gui.allocations.storage(threadAllocationCount() - beforeHistory); // recorded data
+            if (runClock.finished()) stopRun(); // advance done
         } // not running spin moved to end
+        const std::chrono::steady_clock::time_point drawStart = std::chrono::steady_clock::now();
 
         sf::Vector2i mousePos = sf::Mouse::getPosition(
             window); // mouse position is only accurate to end of simulation frames (it does change)
@@ -91,20 +316,47 @@ int main() {
             } else if (event.type == sf::Event::KeyPressed &&
                        event.key.code == sf::Keyboard::Space && !imguIO.WantCaptureKeyboard) {
                 if (running) { // when space bar to stop
-                    running = false;
+                    stopRun();
                 } else { // when space bar to run
-                    sim.save(Previous, {true, true, true});
                     tools[selectedTool]->unequip();
-                    graphs.reset();
-                    runtime = std::chrono::high_resolution_clock::now();
+                    renumber();
+                    TraceSpan saveSpan("save");
+                    sim.save(Previous, {true, true, true});
+                    graphs.reset(sim.gravity);
+                    solver.reset();
+                    runClock.stableStep = solver.integrator == Integrator::Explicit
+                                              ? entities.stableStep()
+                                              : std::numeric_limits<double>::infinity();
+                    if (const std::optional<double> finest =
+                            solver.finestStep(runClock.nominalStep());
+                        finest && *finest > entities.stableStep()) {
+                        std::cout << "Steps of " << *finest << " s are over the stable step of "
+                                  << entities.stableStep() << " s"
+                                  << (solver.integrator == Integrator::Explicit
+                                          ? ", they will be clamped\n"
+                                          : ", the run will likely blow up\n");
+                    }
+                    history.truncate(); // resuming from a scrubbed frame starts a new branch
+                    runClock.reset();
+                    if (history.frames() != 0) runClock.simTime = history.time(history.position);
+                    last = std::chrono::high_resolution_clock::now();
                     running = true;
                 }
             } else if (!running && event.type == sf::Event::KeyPressed &&
                        event.key.code == sf::Keyboard::R && !imguIO.WantCaptureKeyboard) {
+                TraceSpan loadSpan("load");
                 sim.reset();
+                entities.stepBound.invalidate();
+                history.clear();
+                renumber();
             } else {
                 gui.event(event, mousePos);
-                if (!running) tools[selectedTool]->event(event);
+                if (!running) {
+                    TraceSpan toolSpan("tool event");
+                    tools[selectedTool]->event(event);
+                } else {
+                    grabEvent(event);
+                }
             }
         }
 
@@ -131,31 +383,64 @@ int main() {
                 }
                 ImGui::EndTabBar();
             }
+            TraceSpan toolSpan("tool frame");
             tools[selectedTool]->ImTool();
             ImGui::End();
             tools[selectedTool]->frame(sim, mousePos);
         } else {
-            graphs.updateDraw(
-                static_cast<float>((std::chrono::high_resolution_clock::now() - runtime).count()) /
-                1e9F);
+            graphs.updateDraw(static_cast<float>(runClock.simTime), sim.gravity);
         }
 
-        gui.frame(mousePos, sim, graphs, running);
+        gui.frame(mousePos, sim, solver, graphs, runClock, history, recorder, running);
+        if (const std::optional<PointId> grabbed = solver.grab.grabbed()) {
+            const std::array<sf::Vertex, 2> pull{
+                sf::Vertex{visualize(entities.points[static_cast<std::size_t>(*grabbed)].pos),
+                           sf::Color::Yellow},
+                sf::Vertex{visualize(solver.grab.cursor()), sf::Color::Yellow}};
+            window.draw(pull.data(), pull.size(), sf::Lines);
+        }
+        if (gui.loaded) {
+            history.clear();
+            renumber();
+            gui.loaded = false;
+        }
 
         ImGui::SFML::Render(window);
         window.display();
+        const std::chrono::duration<double> drawn = std::chrono::steady_clock::now() - drawStart;
+        gui.drawTime                              = drawn.count();
 
         while ((std::chrono::high_resolution_clock::now() - start).count() <
                10'001'000) { // spin to make 100 VFps
         }
         sinceVFrame       = std::chrono::high_resolution_clock::now() - start;
         const double Vfps = 1e9 / static_cast<double>(sinceVFrame.count());
-        const double Sfps = Vfps * simFrames;
+        const double Sfps = Vfps * static_cast<double>(simFrames);
         gui.fps.add({Vfps, Sfps});
+        gui.allocations.frameEnd(running);
+        publisher.publish(runClock.simTime, runClock.steps, entities, graphs);
+
+        if (Trace::isRecording()) {
+            Trace::counter("points", static_cast<double>(entities.points.size()));
+            Trace::counter("springs", static_cast<double>(entities.springs.size()));
+            Trace::counter("sim frames per visual frame", static_cast<double>(simFrames));
+            Trace::counter("allocations", static_cast<double>(allocationCount()));
+        }
+        if (traceFile && traceLength.count() != 0 &&
+            std::chrono::steady_clock::now() - traceStart > traceLength) {
+            Trace::stop(*traceFile);
+            traceFile.reset();
+        }
     }
 
+    if (traceFile) Trace::stop(*traceFile);
+
     ImPlot::DestroyContext();
     ImGui::SFML::Shutdown();
 
+    if (checkAllocations && gui.allocations.badFrames != 0) {
+        std::cout << gui.allocations.badFrames << " steady state frames allocated\n";
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "Allocations.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+std::atomic<std::uint64_t>                                allocations{0};
+std::array<std::atomic<std::uint64_t>, allocationBuckets> buckets{};
+thread_local std::uint64_t                                threadAllocations = 0;
+
+void count(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    ++threadAllocations;
+    buckets[std::min<std::size_t>(std::bit_width(size), allocationBuckets - 1)].fetch_add(
+        1, std::memory_order_relaxed);
+}
+
+void* countedAlloc(std::size_t size) {
+    count(size);
+    if (size == 0) size = 1; // malloc(0) may return null
+    if (void* ptr = std::malloc(size)) return ptr;
+    throw std::bad_alloc();
+}
+
+// for over-aligned types (alignas above the default new alignment)
+void* countedAlloc(std::size_t size, std::align_val_t alignment) {
+    count(size);
+    const auto align = static_cast<std::size_t>(alignment);
+#ifdef _WIN32
+    if (void* ptr = _aligned_malloc(std::max<std::size_t>(size, 1), align)) return ptr;
+#else
+    const std::size_t rounded = (std::max<std::size_t>(size, 1) + align - 1) / align * align;
+    if (void* ptr = std::aligned_alloc(align, rounded)) return ptr; // size a multiple of align
+#endif
+    throw std::bad_alloc();
+}
+
+void alignedFree(void* ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+} // namespace
+
+std::uint64_t allocationCount() { return allocations.load(std::memory_order_relaxed); }
+
+std::uint64_t threadAllocationCount() { return threadAllocations; }
+
+void allocationHistogram(AllocationHistogram& histogram) {
+    for (std::size_t b = 0; b != allocationBuckets; ++b)
+        histogram[b] = buckets[b].load(std::memory_order_relaxed);
+}
+
+// replacements for the global allocation functions (the rest forward to these by default)
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void  operator delete(void* ptr) noexcept { std::free(ptr); }
+void  operator delete[](void* ptr) noexcept { std::free(ptr); }
+void  operator delete(void* ptr, [[maybe_unused]] std::size_t size) noexcept { std::free(ptr); }
+void  operator delete[](void* ptr, [[maybe_unused]] std::size_t size) noexcept { std::free(ptr); }
+void* operator new(std::size_t size, std::align_val_t align) { return countedAlloc(size, align); }
+void* operator new[](std::size_t size, std::align_val_t align) { return countedAlloc(size, align); }
+void  operator delete(void* ptr, std::align_val_t) noexcept { alignedFree(ptr); }
+void  operator delete[](void* ptr, std::align_val_t) noexcept { alignedFree(ptr); }
+void  operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { alignedFree(ptr); }
+void  operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { alignedFree(ptr); }
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+// process wide heap allocation counter, implemented by replacing the global operator new in
+// Allocations.cpp. Cheap enough (one relaxed atomic increment) to always be on.
+std::uint64_t allocationCount();
+
+// allocations made by the calling thread only
+std::uint64_t threadAllocationCount();
+
+// allocations so far by size, bucket b counts sizes with bit width b (so [2^(b-1), 2^b))
+constexpr std::size_t allocationBuckets = 32;
+using AllocationHistogram               = std::array<std::uint64_t, allocationBuckets>;
+void allocationHistogram(AllocationHistogram& histogram);
+
+// Allocations of each visual frame, for the profiling panel and the steady state check: after
+// the first warmup frames of a run (buffers growing to fit the scene) a frame shouldn't allocate.
+// Recorded data growing (history) is passed to storage and not counted against the frame. Only
+// the thread calling frameStart/frameEnd is counted, background threads (sweeps, the trajectory
+// writer, worker pools) allocate on their own schedule.
+class AllocationMonitor {
+  private:
+    std::uint64_t frameStartCount = 0;
+    std::uint64_t stored          = 0;
+    std::size_t   runFrames       = 0;
+
+  public:
+    std::size_t   warmup    = 100;   // frames at the start of a run allowed to allocate
+    bool          check     = false; // print every frame of a run which allocates after warmup
+    std::uint64_t last      = 0;     // allocations of the last frame
+    std::size_t   badFrames = 0;     // frames past warmup which allocated
+
+    void frameStart() { frameStartCount = threadAllocationCount(); }
+
+    void storage(std::uint64_t count) { stored += count; }
+
+    void frameEnd(bool running) {
+        last   = threadAllocationCount() - frameStartCount - stored;
+        stored = 0;
+        if (!running) {
+            runFrames = 0;
+            return;
+        }
+        if (++runFrames > warmup && last != 0) {
+            ++badFrames;
+            if (check)
+                std::cout << "Frame " << runFrames << " of the run made " << last
+                          << " allocations\n";
+        }
+    }
+};
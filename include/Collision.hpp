@@ -0,0 +1,132 @@
+#pragma once
+
+#include "EntityManager.hpp"
+#include "Fundamentals/Vector2.hpp"
+#include "Polygon.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+// closest point to pos on the boundary of poly
+inline Vec2 closestOnBoundary(const Polygon& poly, const Vec2& pos) {
+    Vec2   closest;
+    double closestDist = std::numeric_limits<double>::infinity();
+    for (const Edge& e: poly.edges) {
+        const Vec2   diff   = e.diff();
+        const double t      = std::clamp((pos - e.p1()).dot(diff) / diff.dot(diff), 0.0, 1.0);
+        const Vec2   onEdge = e.p1() + diff * t;
+        const double dist   = (onEdge - pos).mag();
+        if (dist < closestDist) {
+            closestDist = dist;
+            closest     = onEdge;
+        }
+    }
+    return closest;
+}
+
+// how points bounce off the polygons
+struct SurfaceResponse {
+    double restitution = 0.5; // fraction of the normal speed kept after a bounce
+    double friction    = 0.3; // coulomb coefficient, tangential speed lost per normal speed change
+};
+
+// velocity after hitting a surface with the (outward unit) normal, the normal part is reflected
+// scaled by the restitution and the tangential part slowed by friction, never past zero
+inline void bounce(const SurfaceResponse& response, const Vec2& normal, Vec2& vel) {
+    const double vn = vel.dot(normal);
+    if (vn >= 0) return;
+    const double change  = (1 + response.restitution) * -vn; // of the normal speed
+    const Vec2   tangent = vel - normal * vn;
+    const double speed   = tangent.mag();
+    const double slowed  = std::max(0.0, speed - response.friction * change);
+    vel = normal * (vn + change) + (speed > 0.0 ? tangent * (slowed / speed) : Vec2{});
+}
+
+// pushes a point that has ended up inside poly back to its surface and bounces the velocity
+// (used by the integrators in Solver that step the points themselves)
+inline void collide(const Polygon& poly, Point& point, const SurfaceResponse& response) {
+    if (!poly.isBounded(point.pos) || !poly.isContained(point.pos)) return;
+    const Vec2 surface = closestOnBoundary(poly, point.pos);
+    const Vec2 push    = surface - point.pos;
+    point.pos          = surface;
+    if (push.mag() == 0.0) return;
+    bounce(response, push.norm(), point.vel); // outwards
+}
+
+// axis aligned bounds of a polygon, to skip the swept test for polygons a move can't reach
+struct PolyBounds {
+    Vec2 min;
+    Vec2 max;
+};
+
+inline void updatePolyBounds(const std::vector<Polygon>& polys, std::vector<PolyBounds>& bounds) {
+    bounds.clear();
+    for (const Polygon& poly: polys) {
+        constexpr double inf = std::numeric_limits<double>::infinity();
+        PolyBounds       b{{inf, inf}, {-inf, -inf}};
+        for (const Edge& e: poly.edges) {
+            b.min = {std::min(b.min.x, e.p1().x), std::min(b.min.y, e.p1().y)};
+            b.max = {std::max(b.max.x, e.p1().x), std::max(b.max.y, e.p1().y)};
+        }
+        bounds.push_back(b);
+    }
+}
+
+// earliest crossing of the move from -> to with an edge of poly up to t (as a fraction of the
+// move, ending on an edge counts), lowers t and sets normal to the edge's unit normal on the from
+// side if one is found
+inline bool sweep(const Polygon& poly, const Vec2& from, const Vec2& to, double& t, Vec2& normal) {
+    auto cross = [](const Vec2& a, const Vec2& b) { return a.x * b.y - a.y * b.x; };
+    const Vec2 move  = to - from;
+    bool       found = false;
+    for (const Edge& e: poly.edges) {
+        const Vec2   diff  = e.diff();
+        const double denom = cross(move, diff);
+        if (denom == 0.0) continue; // parallel
+        const Vec2   toEdge = e.p1() - from;
+        const double tHit   = cross(toEdge, diff) / denom;
+        const double along  = cross(toEdge, move) / denom;
+        if (tHit < 0.0 || tHit > t || along < 0.0 || along > 1.0) continue;
+        t      = tHit;
+        normal = Vec2{-diff.y, diff.x}.norm();
+        if (normal.dot(move) > 0) normal = normal * -1.0;
+        found = true;
+    }
+    return found;
+}
+
+// Continuous collision of a point that moved from `from` to its position this step. It is
+// stopped (just short of) where it first crossed into a polygon edge and its velocity
+// bounced, so thin polygons can't be skipped over however big the step. Points that started
+// inside a polygon are left to the discrete push out after.
+inline void collide(const std::vector<Polygon>& polys, const std::vector<PolyBounds>& bounds,
+                    const Vec2& from, Point& point, const SurfaceResponse& response) {
+    constexpr double skin = 1e-9; // gap left to the edge so the next move starts outside
+    const Vec2       lo{std::min(from.x, point.pos.x), std::min(from.y, point.pos.y)};
+    const Vec2       hi{std::max(from.x, point.pos.x), std::max(from.y, point.pos.y)};
+    double           t   = 1.0;
+    bool             hit = false;
+    Vec2             normal;
+    for (std::size_t i = 0; i != polys.size(); ++i) {
+        const PolyBounds& b = bounds[i];
+        if (lo.x > b.max.x || hi.x < b.min.x || lo.y > b.max.y || hi.y < b.min.y) continue;
+        if (polys[i].isBounded(from) && polys[i].isContained(from)) continue;
+        hit = sweep(polys[i], from, point.pos, t, normal) || hit;
+    }
+    if (hit) {
+        point.pos = from + (point.pos - from) * t + normal * skin;
+        bounce(response, normal, point.vel);
+    }
+    for (const Polygon& poly: polys) collide(poly, point, response);
+}
+
+// points are the (non fixed) indices to check, from their positions before the step (indexed
+// the same as entities.points)
+inline void collidePolys(EntityManager& entities, const std::vector<std::size_t>& points,
+                         const std::vector<Vec2>& from, const std::vector<PolyBounds>& bounds,
+                         const SurfaceResponse& response) {
+    if (entities.polys.empty()) return;
+    for (const std::size_t i: points)
+        collide(entities.polys, bounds, from[i], entities.points[i], response);
+}
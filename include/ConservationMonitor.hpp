@@ -0,0 +1,168 @@
+#pragma once
+
+#include "EntityManager.hpp"
+#include "Fundamentals/Vector2.hpp"
+#include "Trace.hpp"
+#include "WorkerPool.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+enum class Channel { Kinetic, Spring, Gravity, Total, MomentumX, MomentumY };
+
+constexpr static std::array ChannelLbl{"Kinetic energy", "Spring energy", "Gravity energy",
+                                       "Total energy",   "Momentum.X",    "Momentum.Y"};
+
+// energy and momentum of the scene
+struct Conserved {
+    double kinetic = 0.0;
+    double spring  = 0.0;
+    double gravity = 0.0; // above the lowest free point at the start of the run
+    Vec2   momentum{};
+
+    double total() const { return kinetic + spring + gravity; }
+
+    double operator[](Channel c) const {
+        switch (c) {
+        case Channel::Kinetic: return kinetic;
+        case Channel::Spring: return spring;
+        case Channel::Gravity: return gravity;
+        case Channel::Total: return total();
+        case Channel::MomentumX: return momentum.x;
+        case Channel::MomentumY: return momentum.y;
+        }
+        return 0.0;
+    }
+
+    Conserved& operator+=(const Conserved& other) {
+        kinetic += other.kinetic;
+        spring += other.spring;
+        gravity += other.gravity;
+        momentum += other.momentum;
+        return *this;
+    }
+};
+
+// Measures the scene's energy and momentum once per graph sample and raises an alarm when they
+// drift from the start of the run. The sums are a parallel reduction over fixed chunks added up
+// in chunk order, so the values don't depend on the thread count.
+//
+// Damping and fixed points only take energy out, so only a rise in the total energy is a drift.
+// Momentum is only checked in closed scenes (no gravity, fixed points or polygons pushing on
+// them), anywhere else it isn't conserved.
+class ConservationMonitor {
+  private:
+    WorkerPool             pool;
+    std::vector<Conserved> partials; // per chunk
+    Conserved              baseline;
+    double                 floor         = 0.0; // height gravity energy is measured from
+    double                 energyScale   = 1.0;
+    double                 momentumScale = 1.0;
+    bool                   closed        = false;
+
+    Conserved measure(const EntityManager& entities, double gravity) {
+        TraceSpan                  span("conservation");
+        const std::vector<Point>&  points  = entities.points;
+        const std::vector<Spring>& springs = entities.springs;
+        const std::size_t          chunks =
+            (std::max(points.size(), springs.size()) + grain - 1) / grain;
+        partials.assign(chunks, Conserved{});
+
+        // the single threaded fallback gets the whole range, split it the same way regardless
+        auto sumPoints = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t c = begin; c < end; c += grain) {
+                Conserved& sum = partials[c / grain];
+                for (std::size_t i = c; i != std::min(c + grain, end); ++i) {
+                    const Point& p = points[i];
+                    if (p.fixed) continue;
+                    sum.kinetic += 0.5 * p.mass * p.vel.dot(p.vel);
+                    sum.gravity += p.mass * gravity * (p.pos.y - floor);
+                    sum.momentum += p.vel * p.mass;
+                }
+            }
+        };
+        auto sumSprings = [&](std::size_t begin, std::size_t end) {
+            for (std::size_t c = begin; c < end; c += grain) {
+                Conserved& sum = partials[c / grain];
+                for (std::size_t i = c; i != std::min(c + grain, end); ++i) {
+                    const Spring& s         = springs[i];
+                    const double  extension = (points[static_cast<std::size_t>(s.p1)].pos -
+                                              points[static_cast<std::size_t>(s.p2)].pos)
+                                                 .mag() -
+                                             s.naturalLength;
+                    sum.spring += 0.5 * s.springConst * extension * extension;
+                }
+            }
+        };
+        pool.parallelFor(points.size(), grain, sumPoints);
+        pool.parallelFor(springs.size(), grain, sumSprings);
+
+        Conserved total;
+        for (const Conserved& partial: partials) total += partial;
+        return total;
+    }
+
+  public:
+    static constexpr std::size_t grain = 8192; // points or springs per task
+
+    bool      enabled           = false; // graph the channels and check for drift
+    double    energyTolerance   = 0.05;  // rise in total energy allowed, of the starting energy
+    double    momentumTolerance = 0.01;  // change in momentum allowed, of the starting scale
+    Conserved latest;
+    bool      energyAlarm   = false;
+    bool      momentumAlarm = false;
+
+    // drift relative to the start of the run
+    double energyDrift() const { return (latest.total() - baseline.total()) / energyScale; }
+    double momentumDrift() const {
+        const Vec2 change = latest.momentum - baseline.momentum;
+        return std::sqrt(change.dot(change)) / momentumScale;
+    }
+    bool momentumChecked() const { return closed; }
+
+    // takes the starting values of a run
+    void start(const EntityManager& entities, double gravity) {
+        energyAlarm   = false;
+        momentumAlarm = false;
+        if (!enabled) return;
+        floor       = std::numeric_limits<double>::infinity();
+        double mass = 0.0;
+        closed      = gravity == 0.0 && entities.polys.empty();
+        for (const Point& p: entities.points) {
+            if (p.fixed) {
+                closed = false;
+                continue;
+            }
+            floor = std::min(floor, p.pos.y);
+            mass += p.mass;
+        }
+        if (!std::isfinite(floor)) floor = 0.0;
+        baseline = measure(entities, gravity);
+        latest   = baseline;
+        // scales floored so a scene starting at rest still has something to compare against
+        energyScale   = std::max(baseline.total(), 1e-9);
+        momentumScale = std::max(std::sqrt(2.0 * mass * baseline.kinetic), 1e-9);
+    }
+
+    // measures the current values and checks them against the start
+    void sample(const EntityManager& entities, double gravity) {
+        if (!enabled) return;
+        latest = measure(entities, gravity);
+        // alarms stay raised for the rest of the run and are printed when first raised, a blown
+        // up (nan) value counts as drifting
+        if (!energyAlarm && !(energyDrift() <= energyTolerance)) {
+            energyAlarm = true;
+            std::cout << "Energy drift: total energy rose " << 100.0 * energyDrift()
+                      << "% since the start of the run\n";
+        }
+        if (!momentumAlarm && closed && !(momentumDrift() <= momentumTolerance)) {
+            momentumAlarm = true;
+            std::cout << "Momentum drift: momentum changed " << 100.0 * momentumDrift()
+                      << "% since the start of the run\n";
+        }
+    }
+};
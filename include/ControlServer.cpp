@@ -0,0 +1,441 @@
+#include "ControlServer.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <exception>
+#include <iostream>
+#include <string>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+bool ControlServer::open(const std::filesystem::path& path_) {
+    std::cout << "The control server (" << path_ << ") needs unix domain sockets\n";
+    return false;
+}
+
+void ControlServer::close() {}
+void ControlServer::run() {}
+void ControlServer::accept() {}
+bool ControlServer::receive(Client&) { return false; }
+void ControlServer::flush(Client&) {}
+#else
+namespace {
+#ifdef MSG_NOSIGNAL
+constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+constexpr int sendFlags = 0; // SIGPIPE is ignored in open instead
+#endif
+
+void setNonBlocking(int fd) { ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK); }
+} // namespace
+
+bool ControlServer::open(const std::filesystem::path& path_) {
+    close();
+    path                   = path_;
+    const std::string name = path.string();
+    sockaddr_un       address{};
+    address.sun_family = AF_UNIX;
+    if (name.size() >= sizeof(address.sun_path)) {
+        std::cout << "Socket path " << path << " is too long\n";
+        return false;
+    }
+    std::copy(name.begin(), name.end(), address.sun_path);
+#ifndef MSG_NOSIGNAL
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    ::unlink(name.c_str()); // a socket file left by an earlier run
+    listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == -1 ||
+        ::bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listener, 8) != 0) {
+        std::cout << "Failed to listen on " << path << "\n";
+        close();
+        return false;
+    }
+    setNonBlocking(listener);
+    std::cout << "Listening on " << path << "\n";
+    return true;
+}
+
+void ControlServer::close() {
+    for (const Client& client: clients) ::close(client.fd);
+    clients.clear();
+    if (listener == -1) return;
+    ::close(listener);
+    ::unlink(path.c_str());
+    listener = -1;
+}
+
+void ControlServer::accept() {
+    while (true) {
+        const int fd = ::accept(listener, nullptr, nullptr);
+        if (fd == -1) return; // none waiting
+        setNonBlocking(fd);
+        clients.emplace_back().fd = fd;
+    }
+}
+
+bool ControlServer::receive(Client& client) {
+    std::array<std::byte, 1U << 16> buffer;
+    bool                            open = true; // the messages sent before closing still count
+    while (true) {
+        const ssize_t got = ::recv(client.fd, buffer.data(), buffer.size(), 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (got <= 0) {
+            open = false;
+            break;
+        }
+        client.in.insert(client.in.end(), buffer.begin(), buffer.begin() + got);
+    }
+    std::size_t used = 0;
+    while (const std::optional<MessageHeader> header =
+               completeMessage(client.in.data() + used, client.in.size() - used)) {
+        if (header->size > maxPayload) return false; // not speaking the protocol
+        MessageReader payload(client.in.data() + used + sizeof(MessageHeader), header->size);
+        handle(client, static_cast<Request>(header->type), payload);
+        used += sizeof(MessageHeader) + header->size;
+    }
+    client.in.erase(client.in.begin(), client.in.begin() + static_cast<std::ptrdiff_t>(used));
+    return open;
+}
+
+void ControlServer::flush(Client& client) {
+    while (client.sent != client.out.size()) {
+        const ssize_t wrote = ::send(client.fd, client.out.data() + client.sent,
+                                     client.out.size() - client.sent, sendFlags);
+        if (wrote <= 0) break; // full, or gone which receive notices
+        client.sent += static_cast<std::size_t>(wrote);
+    }
+    if (client.sent == client.out.size()) {
+        client.out.clear();
+        client.sent = 0;
+    }
+}
+
+void ControlServer::run() {
+    std::vector<pollfd> fds;
+    while (!shuttingDown) {
+        const bool stepping = running || stepsOwed != 0;
+        fds.clear();
+        fds.push_back({listener, POLLIN, 0});
+        for (const Client& client: clients) {
+            const bool unsent = client.sent != client.out.size();
+            fds.push_back({client.fd, static_cast<short>(POLLIN | (unsent ? POLLOUT : 0)), 0});
+        }
+        if (::poll(fds.data(), fds.size(), stepping ? 0 : idleWaitMs) < 0 && errno != EINTR) {
+            std::cout << "Control server poll failed\n";
+            break;
+        }
+
+        for (std::size_t i = 0; i != clients.size(); ++i) {
+            if ((fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) != 0 && !receive(clients[i]))
+                clients[i].gone = true;
+        }
+        std::erase_if(clients, [&](const Client& client) {
+            if (!client.gone) return false;
+            ::close(client.fd);
+            if (stepClient == client.fd) stepClient.reset(); // the fd may be reused
+            return true;
+        });
+        if (updateMonitor()) sendChannels(); // a client that wanted it left
+        if ((fds[0].revents & POLLIN) != 0) accept();
+
+        if (running || stepsOwed != 0) {
+            TraceSpan span("sim steps");
+
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            do {
+                stepOnce();
+            } while ((running || stepsOwed != 0) &&
+                     std::chrono::steady_clock::now() - start < stepSlice);
+        }
+
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (Client& client: clients) {
+            if ((client.rowCount != 0 || client.dropped != 0) &&
+                now - client.lastBatch >= std::chrono::duration<double>(1.0 / client.maxRate)) {
+                client.lastBatch = now;
+                sendBatch(client);
+            }
+            flush(client);
+        }
+    }
+    for (Client& client: clients) flush(client); // the shutdown ack
+}
+#endif
+
+void ControlServer::ack(Client& client, Request request, bool ok, std::string_view message) {
+    MessageWriter writer(client.out);
+    writer.begin(Reply::Ack)
+        .put(static_cast<std::uint16_t>(request))
+        .put(static_cast<std::uint8_t>(ok))
+        .put(message);
+    writer.finish();
+}
+
+void ControlServer::sendChannels() {
+    graphs.assignColumns(); // graphs added since the last sample get their columns
+    std::uint32_t count = 0;
+    graphs.forLatest([&](std::string_view, float) { ++count; });
+    for (Client& client: clients) {
+        if (!client.subscribed) continue;
+        if (client.rowCount != 0) sendBatch(client); // rows of the old channels
+        MessageWriter writer(client.out);
+        writer.begin(Reply::Channels).put(count);
+        graphs.forLatest([&](std::string_view label, float) { writer.put(label); });
+        writer.finish();
+        client.columns = count;
+    }
+}
+
+bool ControlServer::updateMonitor() {
+    const bool wanted = std::any_of(clients.begin(), clients.end(), [](const Client& client) {
+        return client.subscribed && client.conservation;
+    });
+    if (wanted == graphs.monitor.enabled) return false;
+    graphs.monitor.enabled = wanted;
+    if (wanted && runStarted) graphs.monitor.start(entities, sim.gravity); // mid run baseline
+    return true;
+}
+
+void ControlServer::sendBatch(Client& client) {
+    MessageWriter writer(client.out);
+    writer.begin(Reply::Frames).put(client.rowCount).put(client.columns).put(client.dropped);
+    client.out.insert(client.out.end(), client.rows.begin(), client.rows.end());
+    writer.finish();
+    client.rows.clear();
+    client.rowCount = 0;
+    client.dropped  = 0;
+}
+
+void ControlServer::beginRun() {
+    if (runStarted) return;
+    solver.reset();
+    graphs.reset(sim.gravity);
+    simTime    = 0.0;
+    steps      = 0;
+    runStarted = true;
+}
+
+void ControlServer::stepOnce() {
+    beginRun();
+    const double h = solver.integrator == Integrator::Explicit
+                         ? std::min(deltaTime, entities.stableStep())
+                         : deltaTime;
+    solver.step(sim, h);
+    simTime += h;
+    ++steps;
+    sample();
+    if (stepsOwed == 0 || --stepsOwed != 0 || !stepClient) return;
+    for (Client& client: clients) {
+        if (client.fd != *stepClient) continue;
+        if (client.rowCount != 0) sendBatch(client); // the steps' rows before their ack
+        ack(client, Request::Step, true, "Stepped to " + std::to_string(simTime) + " s");
+    }
+    stepClient.reset();
+}
+
+void ControlServer::sample() {
+    bool sampled = false;
+    for (Client& client: clients) {
+        if (!client.subscribed || steps % client.sampleEvery != 0) continue;
+        if (!sampled) {
+            graphs.sample(static_cast<float>(simTime), sim.gravity);
+            values.clear();
+            graphs.forLatest([&](std::string_view, float value) { values.push_back(value); });
+            sampled = true;
+        }
+        if (client.out.size() - client.sent > outLimit || client.rows.size() > outLimit) {
+            ++client.dropped; // slow client, don't queue more
+            continue;
+        }
+        MessageWriter writer(client.rows);
+        writer.put(simTime);
+        for (const float value: values) writer.put(value);
+        ++client.rowCount;
+    }
+}
+
+void ControlServer::handle(Client& client, Request request, MessageReader& payload) {
+    switch (request) {
+    case Request::Load: {
+        const std::string scene = payload.getString();
+        if (!payload.ok()) break;
+        if (running || stepsOwed != 0)
+            return ack(client, request, false, "Stop the run before loading");
+        if (!std::filesystem::is_regular_file(scene))
+            return ack(client, request, false, "No scene at " + scene);
+        try {
+            sim.load(scene, true, {true, true, true});
+            solver.loadSettings(scene);
+        } catch (const std::exception& e) {
+            return ack(client, request, false, e.what());
+        }
+        entities.graphs.clear(); // they referred to the old scene
+        entities.stepBound.invalidate();
+        runStarted = false;
+        sendChannels();
+        return ack(client, request, true,
+                   "Loaded " + std::to_string(entities.points.size()) + " points and " +
+                       std::to_string(entities.springs.size()) + " springs");
+    }
+    case Request::SetGravity: {
+        const auto gravity = payload.get<double>();
+        if (!payload.ok()) break;
+        if (!std::isfinite(gravity)) return ack(client, request, false, "Gravity must be finite");
+        sim.gravity = gravity;
+        return ack(client, request, true, "Gravity set");
+    }
+    case Request::SetPoint: {
+        const auto id    = payload.get<std::uint64_t>();
+        const auto field = payload.get<PointField>();
+        const auto value = payload.get<double>();
+        if (!payload.ok()) break;
+        if (id >= entities.points.size()) return ack(client, request, false, "No such point");
+        if (!std::isfinite(value)) return ack(client, request, false, "Value must be finite");
+        Point& p = entities.points[static_cast<std::size_t>(id)];
+        switch (field) {
+        case PointField::PosX: p.pos.x = value; break;
+        case PointField::PosY: p.pos.y = value; break;
+        case PointField::VelX: p.vel.x = value; break;
+        case PointField::VelY: p.vel.y = value; break;
+        case PointField::Mass:
+            if (value <= 0.0) return ack(client, request, false, "Mass must be positive");
+            p.mass = value;
+            break;
+        case PointField::Fixed:
+            p.fixed = value != 0.0;
+            solver.islands.invalidate(); // the point joins or leaves its body
+            break;
+        default: return ack(client, request, false, "Unknown point field");
+        }
+        entities.pointEdited(PointId{id});
+        solver.islands.wake(static_cast<std::size_t>(id));
+        if (!running) runStarted = false;
+        return ack(client, request, true, "Point set");
+    }
+    case Request::SetSpring: {
+        const auto id    = payload.get<std::uint64_t>();
+        const auto field = payload.get<SpringField>();
+        const auto value = payload.get<double>();
+        if (!payload.ok()) break;
+        if (id >= entities.springs.size()) return ack(client, request, false, "No such spring");
+        if (!std::isfinite(value) || value < 0.0)
+            return ack(client, request, false, "Value must be finite and not negative");
+        Spring& s = entities.springs[static_cast<std::size_t>(id)];
+        switch (field) {
+        case SpringField::SpringConst: s.springConst = value; break;
+        case SpringField::NaturalLength: s.naturalLength = value; break;
+        case SpringField::DampFact: s.dampFact = value; break;
+        default: return ack(client, request, false, "Unknown spring field");
+        }
+        entities.springEdited(SpringId{id});
+        solver.islands.wake(static_cast<std::size_t>(s.p1));
+        if (!running) runStarted = false;
+        return ack(client, request, true, "Spring set");
+    }
+    case Request::SetStep: {
+        const auto step = payload.get<double>();
+        if (!payload.ok()) break;
+        if (!std::isfinite(step) || step <= 0.0)
+            return ack(client, request, false, "Step must be positive");
+        deltaTime = step;
+        return ack(client, request, true, "Step set");
+    }
+    case Request::AddGraph: {
+        const auto type = payload.get<std::uint8_t>();
+        const auto id   = payload.get<std::uint64_t>();
+        const auto prop = static_cast<Property>(payload.get<std::uint8_t>());
+        const auto comp = static_cast<Component>(payload.get<std::uint8_t>());
+        if (!payload.ok()) break;
+        const bool point = type == static_cast<std::uint8_t>(ObjectType::Point);
+        if (type > static_cast<std::uint8_t>(ObjectType::Spring) ||
+            id >= (point ? entities.points.size() : entities.springs.size()))
+            return ack(client, request, false, "No such point or spring");
+        const bool pointProp = prop == Property::Position || prop == Property::Velocity;
+        if (pointProp != point || static_cast<std::size_t>(prop) >= PropLbl.size() ||
+            static_cast<std::size_t>(comp) >= CompLbl.size())
+            return ack(client, request, false, "Property or component doesn't fit the object");
+        // set up like the graph tool's default graph
+        if (point)
+            entities.graphs.push_back(Graph{PointId{id}, prop, comp});
+        else
+            entities.graphs.push_back(Graph{SpringId{id}, prop, comp});
+        sendChannels();
+        return ack(client, request, true, entities.graphs.back().getYLabel());
+    }
+    case Request::Start:
+        beginRun();
+        running = true;
+        return ack(client, request, true, "Running");
+    case Request::Stop:
+        running = false;
+        if (stepsOwed != 0) { // cut short
+            stepsOwed = 0;
+            for (Client& stepper: clients) {
+                if (stepClient && stepper.fd == *stepClient)
+                    ack(stepper, Request::Step, false, "Stopped before all the steps were taken");
+            }
+            stepClient.reset();
+        }
+        return ack(client, request, true, "Stopped at " + std::to_string(simTime) + " s");
+    case Request::Step: {
+        const auto count = payload.get<std::uint64_t>();
+        if (!payload.ok()) break;
+        if (running || stepsOwed != 0)
+            return ack(client, request, false, "Already running or stepping");
+        if (count == 0) return ack(client, request, true, "Stepped nothing");
+        stepsOwed  = count;
+        stepClient = client.fd; // acked once they are done
+        return;
+    }
+    case Request::Subscribe: {
+        const auto every        = payload.get<std::uint32_t>();
+        const auto rate         = payload.get<double>();
+        const auto conservation = payload.get<std::uint8_t>() != 0;
+        if (!payload.ok()) break;
+        if (every == 0 || !(rate > 0.0))
+            return ack(client, request, false, "Sample steps and rate must be positive");
+        client.subscribed   = true;
+        client.sampleEvery  = every;
+        client.maxRate      = rate;
+        client.conservation = conservation;
+        updateMonitor(); // shared by every subscriber
+        sendChannels();
+        return ack(client, request, true, "Subscribed");
+    }
+    case Request::Unsubscribe:
+        client.subscribed = false;
+        client.rows.clear();
+        client.rowCount = 0;
+        if (updateMonitor()) sendChannels(); // the other subscribers lose the monitor channels
+        return ack(client, request, true, "Unsubscribed");
+    case Request::Status: {
+        MessageWriter writer(client.out);
+        writer.begin(Reply::Status)
+            .put(simTime)
+            .put(steps)
+            .put(static_cast<std::uint8_t>(running))
+            .put(static_cast<std::uint64_t>(entities.points.size()))
+            .put(static_cast<std::uint64_t>(entities.springs.size()));
+        writer.finish();
+        return;
+    }
+    case Request::Shutdown:
+        shuttingDown = true;
+        return ack(client, request, true, "Shutting down");
+    default: return ack(client, request, false, "Unknown request");
+    }
+    ack(client, request, false, "Malformed request");
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "EntityManager.hpp"
+#include "GraphMananager.hpp"
+#include "Protocol.hpp"
+#include "Sim.hpp"
+#include "Solver.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+// Headless session driven over a Unix domain socket with the protocol in Protocol.hpp, for
+// automation. Clients load scenes, edit them, start, stop and step the sim, and subscribe to the
+// graph channels. A run starts over (solver and graphs reset, time from 0) on the first step
+// after loading or editing while stopped, otherwise Start resumes it.
+//
+// The sockets are non blocking and the sim steps in slices of a couple of ms between polls, so
+// a slow client never stalls stepping. A subscriber's samples are batched and sent at most at
+// its rate, and while its unsent data is over the limit its rows are dropped (and counted)
+// instead of queued.
+class ControlServer {
+  public:
+    static constexpr std::size_t              outLimit   = 4U << 20; // unsent bytes per client
+    static constexpr std::chrono::nanoseconds stepSlice  = std::chrono::milliseconds(2);
+    static constexpr int                      idleWaitMs = 50; // poll timeout when not stepping
+
+    ControlServer(EntityManager& entities_, Sim& sim_, Solver& solver_, GraphManager& graphs_)
+        : entities(entities_), sim(sim_), solver(solver_), graphs(graphs_) {}
+    ~ControlServer() { close(); }
+    ControlServer(const ControlServer& other)            = delete;
+    ControlServer& operator=(const ControlServer& other) = delete;
+
+    // listens on the socket path (replacing a stale socket file), false if it couldn't
+    bool open(const std::filesystem::path& path_);
+    void close();
+
+    // serves until a client asks to shut down
+    void run();
+
+  private:
+    struct Client {
+        int                    fd = -1;
+        std::vector<std::byte> in;
+        std::vector<std::byte> out;
+        std::size_t            sent = 0; // of out
+        bool                   gone = false;
+
+        // subscription
+        bool                                  subscribed  = false;
+        std::uint32_t                         sampleEvery  = 1;     // steps
+        double                                maxRate      = 30.0;  // batches per second
+        bool                                  conservation = false; // wants the monitor channels
+        std::uint32_t                         columns     = 0;    // in the last Channels sent
+        std::vector<std::byte>                rows;               // time and values of each row
+        std::uint32_t                         rowCount = 0;
+        std::uint64_t                         dropped  = 0;
+        std::chrono::steady_clock::time_point lastBatch{};
+    };
+
+    void accept();
+    bool receive(Client& client); // false when the client is gone
+    void flush(Client& client);   // writes what the socket takes without blocking
+    void handle(Client& client, Request request, MessageReader& payload);
+    void ack(Client& client, Request request, bool ok, std::string_view message);
+    void sendChannels();  // to every subscriber, after the channels changed
+    bool updateMonitor(); // on while any subscriber wants it, true if that changed
+    void sendBatch(Client& client);
+
+    void beginRun(); // resets the solver and graphs on the first step after loading or editing
+    void stepOnce();
+    void sample();
+
+    EntityManager& entities;
+    Sim&           sim;
+    Solver&        solver;
+    GraphManager&  graphs;
+
+    std::filesystem::path path;
+    int                   listener = -1;
+    std::vector<Client>   clients;
+    std::vector<float>    values; // scratch for a row
+
+    double             deltaTime    = 0.001; // per step
+    double             simTime      = 0.0;
+    std::uint64_t      steps        = 0;
+    bool               running      = false;
+    bool               runStarted   = false;
+    bool               shuttingDown = false;
+    std::uint64_t      stepsOwed    = 0; // of a Step request
+    std::optional<int> stepClient;       // fd to ack once they are done
+};
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Graph.hpp"
+#include "Renumber.hpp"
 #include "SFML/Graphics.hpp"
+#include "StepBound.hpp"
 #include "physics-envy/Engine.hpp"
 #include "physics-envy/Spring.hpp"
 #include <cstddef>
@@ -20,9 +22,30 @@ class EntityManager {
     std::vector<sf::Vertex> pointVerts;
     std::vector<sf::Vertex> springVerts;
     std::vector<Graph>      graphs;
+    bool                    autoRenumber = true; // renumber for locality on run and load
+    StepBound               stepBound;
+
+    // largest step explicit integration is stable at (with the safety margin)
+    double stableStep() {
+        stepBound.refresh(engine.points, engine.springs);
+        return stepBound.stableStep();
+    }
+    double stableStep(PointId p) {
+        stepBound.refresh(engine.points, engine.springs);
+        return stepBound.stableStep(static_cast<std::size_t>(p));
+    }
+
+    // call after changing a point's mass or fixed, or a spring's constant or damping
+    void pointEdited(PointId p) {
+        stepBound.pointEdited(static_cast<std::size_t>(p), engine.points);
+    }
+    void springEdited(SpringId s) {
+        stepBound.springEdited(static_cast<std::size_t>(s), engine.points, engine.springs);
+    }
 
     void addPoint(const Point& p) {
         engine.addPoint(p);
+        stepBound.pointAdded(engine.points);
         pointVerts.emplace_back(sf::Vector2f{}, p.color, sf::Vector2f{0, 0});
         pointVerts.emplace_back(sf::Vector2f{}, p.color, sf::Vector2f{300, 0});
         pointVerts.emplace_back(sf::Vector2f{}, p.color, sf::Vector2f{300, 300});
@@ -31,6 +54,7 @@ class EntityManager {
 
     void addSpring(const Spring& s) {
         engine.addSpring(s);
+        stepBound.springEdited(engine.springs.size() - 1, engine.points, engine.springs);
         springVerts.emplace_back();
         springVerts.emplace_back();
     }
@@ -64,10 +88,12 @@ class EntityManager {
         graphs.erase(GEnd, graphs.end()); // finish the deleting of the graphs
 
         engine.rmvPoint(pos);
+        stepBound.invalidate(); // the point's springs go with it
     }
 
     void rmvSpring(SpringId pos) {
         engine.rmvSpring(pos);
+        stepBound.springRemoved(static_cast<std::size_t>(pos), engine.points);
         SpringId old = static_cast<SpringId>(engine.springs.size() - 1);
 
         springVerts[static_cast<std::size_t>(pos) * 2] =
@@ -91,6 +117,36 @@ class EntityManager {
         graphs.erase(GEnd, graphs.end()); // finish the deleting of the graphs
     }
 
+    // applies a permutation to the points and springs (and everything refering to them)
+    void renumber(const Renumbering& renumbering) {
+        std::vector<Point>      newPoints = engine.points;
+        std::vector<sf::Vertex> newPointVerts(pointVerts.size());
+        for (std::size_t i = 0; i != engine.points.size(); ++i) {
+            const std::size_t to = static_cast<std::size_t>(renumbering.points[i]);
+            newPoints[to]        = engine.points[i];
+            std::copy_n(pointVerts.begin() + static_cast<long>(i * 4), 4,
+                        newPointVerts.begin() + static_cast<long>(to * 4));
+        }
+        engine.points = std::move(newPoints);
+        pointVerts    = std::move(newPointVerts);
+
+        std::vector<Spring>     newSprings = engine.springs;
+        std::vector<sf::Vertex> newSpringVerts(springVerts.size());
+        for (std::size_t i = 0; i != engine.springs.size(); ++i) {
+            const std::size_t to       = static_cast<std::size_t>(renumbering.springs[i]);
+            newSprings[to]             = engine.springs[i];
+            newSprings[to].p1          = renumbering(engine.springs[i].p1);
+            newSprings[to].p2          = renumbering(engine.springs[i].p2);
+            newSpringVerts[to * 2]     = springVerts[i * 2];
+            newSpringVerts[to * 2 + 1] = springVerts[i * 2 + 1];
+        }
+        engine.springs = std::move(newSprings);
+        springVerts    = std::move(newSpringVerts);
+
+        for (Graph& g: graphs) g.renumber(renumbering);
+        stepBound.invalidate();
+    }
+
     void updatePointVisPos(float radius) {
         for (std::size_t i = 0; i != points.size(); ++i) {
             sf::Vector2f pos               = visualize(points[i].pos);
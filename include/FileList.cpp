@@ -0,0 +1,108 @@
+#include "FileList.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+std::string formatSize(std::uintmax_t bytes) {
+    int    i{};
+    double mantissa = static_cast<double>(bytes);
+    for (; mantissa >= 1024.; ++i) {
+        mantissa /= 1024.;
+    }
+    mantissa = std::ceil(mantissa * 10.) / 10.;
+    std::array<char, 16> str{};
+    std::snprintf(str.data(), str.size(), "%.4g %cB", mantissa, "BKMGTPE"[i]);
+    return str.data();
+}
+
+std::string formatTime(std::filesystem::file_time_type time) {
+    std::time_t cftime =
+        std::chrono::system_clock::to_time_t(std::chrono::file_clock::to_sys(time));
+    std::string str = std::asctime(std::localtime(&cftime));
+    str.pop_back(); // rm the trailing '\n' put by `asctime`
+    return str;
+}
+} // namespace
+
+FileList::FileList(std::filesystem::path directory_, std::string extension_)
+    : directory(std::move(directory_)), extension(std::move(extension_)) {
+    std::filesystem::create_directories(directory);
+#ifdef __linux__
+    watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch != -1 &&
+        inotify_add_watch(watch, directory.c_str(),
+                          IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO |
+                              IN_DELETE_SELF | IN_MOVE_SELF) == -1) {
+        ::close(watch);
+        watch = -1; // fall back to polling
+    }
+#endif
+}
+
+FileList::~FileList() {
+#ifdef __linux__
+    if (watch != -1) ::close(watch);
+#endif
+}
+
+bool FileList::changed() {
+#ifdef __linux__
+    if (watch != -1) {
+        // the events themselves don't matter, just whether there were any
+        alignas(inotify_event) std::array<char, 4096> events;
+        bool                                          any = false;
+        while (::read(watch, events.data(), events.size()) > 0) any = true;
+        return any;
+    }
+#endif
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - lastPoll < pollInterval) return false;
+    lastPoll = now;
+    std::error_code                       error;
+    const std::filesystem::file_time_type dirTime =
+        std::filesystem::last_write_time(directory, error);
+    if (error || dirTime == lastDirTime) return false;
+    lastDirTime = dirTime;
+    return true;
+}
+
+void FileList::scan() {
+    TraceSpan span("file list scan");
+    std::optional<std::filesystem::path> selectedPath;
+    if (const Entry* entry = selection()) selectedPath = entry->path;
+
+    files.clear();
+    std::error_code error;
+    for (const auto& entry: std::filesystem::directory_iterator(directory, error)) {
+        if (entry.path().extension() != extension) continue;
+        const std::filesystem::file_time_type writeTime = entry.last_write_time(error);
+        if (error) continue; // removed while scanning
+        files.push_back({entry.path(), entry.path().stem().string(),
+                         formatSize(entry.file_size(error)), formatTime(writeTime), writeTime});
+    }
+    std::sort(files.begin(), files.end(),
+              [](const Entry& lhs, const Entry& rhs) { return lhs.writeTime > rhs.writeTime; });
+
+    selected.reset();
+    for (std::size_t i = 0; i != files.size(); ++i) {
+        if (selectedPath && files[i].path == *selectedPath) selected = i;
+    }
+}
+
+const std::vector<FileList::Entry>& FileList::entries() {
+    if (changed() || stale) {
+        stale = false;
+        scan();
+    }
+    return files;
+}
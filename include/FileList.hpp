@@ -0,0 +1,53 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Cached listing of the files with an extension in a directory, newest first, with the size and
+// modified time already formatted for display. The directory is only rescanned when it changes,
+// watched with inotify on linux, elsewhere (or if the watch fails) by checking the directory's
+// modified time every pollInterval.
+class FileList {
+  public:
+    struct Entry {
+        std::filesystem::path           path;
+        std::string                     name; // stem
+        std::string                     size;
+        std::string                     time;
+        std::filesystem::file_time_type writeTime;
+    };
+
+    static constexpr std::chrono::milliseconds pollInterval{1000};
+
+    FileList(std::filesystem::path directory_, std::string extension_);
+    ~FileList();
+    FileList(const FileList& other)            = delete;
+    FileList& operator=(const FileList& other) = delete;
+
+    // the listing, rescanned first if the directory changed
+    const std::vector<Entry>& entries();
+
+    // forces a rescan on the next entries() (eg after writing a file the poll could miss)
+    void invalidate() { stale = true; }
+
+    std::optional<std::size_t> selected; // kept on the same file across rescans
+    const Entry*               selection() const {
+        return selected && *selected < files.size() ? &files[*selected] : nullptr;
+    }
+
+  private:
+    bool changed();
+    void scan();
+
+    std::filesystem::path                 directory;
+    std::string                           extension;
+    std::vector<Entry>                    files;
+    bool                                  stale = true;
+    int                                   watch = -1; // inotify fd
+    std::chrono::steady_clock::time_point lastPoll;
+    std::filesystem::file_time_type       lastDirTime;
+};
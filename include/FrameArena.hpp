@@ -0,0 +1,36 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+
+// Bump allocator for data that only lives for one visual frame (formatted ui labels), reset at
+// the start of every frame so steady state frames don't touch the heap. Running out of space
+// truncates instead of allocating.
+class FrameArena {
+  private:
+    std::unique_ptr<char[]> buffer = std::make_unique<char[]>(capacity);
+    std::size_t             used   = 0;
+
+  public:
+    static constexpr std::size_t capacity = 64 * 1024;
+
+    void reset() { used = 0; }
+
+    // printf into the arena, valid until the next reset
+    const char* format(const char* fmt, ...) {
+        if (used == capacity) return "";
+        char*   out = buffer.get() + used;
+        va_list args;
+        va_start(args, fmt);
+        const int written = std::vsnprintf(out, capacity - used, fmt, args);
+        va_end(args);
+        if (written < 0) return "";
+        used = std::min(capacity, used + static_cast<std::size_t>(written) + 1);
+        return out;
+    }
+};
+
+inline FrameArena frameArena; // main thread only
@@ -1,21 +1,38 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <exception>
 #include <filesystem>
+#include <limits>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
+#include "Allocations.hpp"
 #include "Debug.hpp"
 #include "EntityManager.hpp"
+#include "FileList.hpp"
+#include "FrameArena.hpp"
 #include "Graph.hpp"
 #include "GraphMananager.hpp"
+#include "History.hpp"
 #include "ImguiHelpers.hpp"
+#include "QualityGovernor.hpp"
+#include "RunClock.hpp"
 #include "SFML/Graphics.hpp"
 #include "SFML/System/Vector2.hpp"
 #include "SFML/Window.hpp"
 #include "Sim.hpp"
+#include "Solver.hpp"
+#include "Sweep.hpp"
+#include "Timestamp.hpp"
+#include "Trace.hpp"
+#include "Trajectory.hpp"
 #include "fundamentals/RingBuffer.hpp"
 #include "imgui.h"
 #include "implot.h"
@@ -28,40 +45,73 @@ sf::Vector2f visualize(const Vec2& v);
 
 // checkbox ui for objects
 inline void enabledCheckBoxes(ObjectEnabled& enabled, const EntityManager& entities,
-                              const std::string& uuid, bool forceLegit = false) {
+                              const char* uuid, bool forceLegit = false) {
+    ImGui::PushID(uuid);
     if (enabled.springs && forceLegit) ImGui::BeginDisabled();
-    ImGui::Checkbox((std::string{"Points##"} + uuid).c_str(), &enabled.points);
+    ImGui::Checkbox("Points", &enabled.points);
     ImGui::SameLine();
     ImGui::TextDisabled("%zu", entities.points.size());
     if (enabled.springs && forceLegit) ImGui::EndDisabled();
     ImGui::SameLine();
-    ImGui::Checkbox((std::string{"Springs##"} + uuid).c_str(), &enabled.springs);
+    ImGui::Checkbox("Springs", &enabled.springs);
     ImGui::SameLine();
     ImGui::TextDisabled("%zu", entities.springs.size());
     ImGui::SameLine();
-    ImGui::Checkbox((std::string{"Polygons##"} + uuid).c_str(), &enabled.polygons);
+    ImGui::Checkbox("Polygons", &enabled.polygons);
     ImGui::SameLine();
     ImGui::TextDisabled("%zu", entities.polys.size());
     if (enabled.springs && forceLegit) enabled.points = true;
+    ImGui::PopID();
 }
 
-// stolen from - https://en.cppreference.com/w/cpp/filesystem/directory_entry/last_write_time
-inline std::string to_string(fs::file_time_type const& ftime) {
-    std::time_t cftime =
-        std::chrono::system_clock::to_time_t(std::chrono::file_clock::to_sys(ftime));
-    std::string str = std::asctime(std::localtime(&cftime));
-    str.pop_back(); // rm the trailing '\n' put by `asctime`
-    return str;
+// list box of the files in a file list, only the visible rows are drawn
+inline void fileListBox(const char* label, FileList& list, float rows, bool showTime) {
+    const std::vector<FileList::Entry>& files  = list.entries();
+    const float                         height = ImGui::GetTextLineHeightWithSpacing() *
+                                 std::min(rows, static_cast<float>(files.size())) +
+                             2.0F;
+    if (ImGui::BeginListBox(label, {440.0f, height})) {
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(files.size()));
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                const auto i           = static_cast<std::size_t>(row);
+                const bool is_selected = list.selected == i;
+                if (ImGui::Selectable(files[i].name.c_str(), is_selected)) list.selected = i;
+                ImGui::SameLine(showTime ? 160.0F : 240.0F);
+                ImGui::TextUnformatted(files[i].size.c_str());
+                if (showTime) {
+                    ImGui::SameLine(240.0F);
+                    ImGui::TextUnformatted(files[i].time.c_str());
+                }
+                if (is_selected) ImGui::SetItemDefaultFocus();
+            }
+        }
+        ImGui::EndListBox();
+    }
 }
 
-inline void display_size(fs::directory_entry file) {
-    int    i{};
-    double mantissa = static_cast<double>(file.file_size());
-    for (; mantissa >= 1024.; ++i) {
-        mantissa /= 1024.;
+// convex hull of points (reordered) in counter clockwise order, monotone chain
+inline void convexHull(std::vector<sf::Vector2f>& points, std::vector<sf::Vector2f>& hull) {
+    std::sort(points.begin(), points.end(), [](const sf::Vector2f& lhs, const sf::Vector2f& rhs) {
+        return lhs.x < rhs.x || (lhs.x == rhs.x && lhs.y < rhs.y);
+    });
+    auto cross = [](const sf::Vector2f& o, const sf::Vector2f& a, const sf::Vector2f& b) {
+        return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+    };
+    hull.clear();
+    for (const sf::Vector2f& p: points) { // lower
+        while (hull.size() >= 2 && cross(hull[hull.size() - 2], hull.back(), p) <= 0)
+            hull.pop_back();
+        hull.push_back(p);
     }
-    mantissa = std::ceil(mantissa * 10.) / 10.;
-    ImGui::Text("%.4g %cB", mantissa, "BKMGTPE"[i]);
+    const std::size_t lower = hull.size() + 1;
+    for (std::size_t i = points.size() - 1; i-- != 0;) { // upper
+        while (hull.size() >= lower && cross(hull[hull.size() - 2], hull.back(), points[i]) <= 0)
+            hull.pop_back();
+        hull.push_back(points[i]);
+    }
+    hull.pop_back(); // same as the first
 }
 
 class GUI {
@@ -76,22 +126,64 @@ class GUI {
     std::optional<sf::Vector2i> mousePosLast;
     float                       radius;
 
+    std::optional<TrajectoryReader> replay;
+    double                          replayTime    = 0.0;
+    double                          replaySpeed   = 1.0;
+    bool                            replayPlaying = false;
+    std::optional<std::size_t>      replayFrame; // last loaded into the scene
+    std::string                     replayError; // of the last recording opened
+
+    Sweep sweep;
+
+    FileList    sims{"sims", ".csv"};
+    FileList    recordings{"trajectories", ".traj"};
+    std::string loadError; // of the last scene load, shown under the load button
+
+    AllocationHistogram                  histogram{};
+    std::array<float, allocationBuckets> histogramPlot{};
+
+    // lowered detail drawing (kept between frames to avoid reallocating)
+    static constexpr float   splatPixels = 6.0F; // density splat cell size
+    std::vector<sf::Vertex>  springDraw;
+    std::vector<sf::Vertex>  splatVerts;
+    std::vector<std::size_t> splatCounts; // points per cell
+    std::vector<std::size_t> splatCells;  // occupied cells
+
+    // level of detail, bodies smaller than lodPixels on screen are drawn as their outline hull
+    static constexpr std::size_t lodMinPoints = 8; // smaller bodies are always drawn in full
+    bool                         lod          = true;
+    float                        lodPixels    = 40.0F;
+    bool                         anyHull      = false;
+    std::vector<std::uint8_t>    detailed; // per island, drawn in full
+    std::vector<sf::Vector2f>    hullPoints;
+    std::vector<sf::Vector2f>    hull;
+    std::vector<sf::Vertex>      hullFill;
+    std::vector<sf::Vertex>      hullLines;
+    std::vector<sf::Vertex>      pointDraw;
+
     ObjectEnabled loading{true, true, true};
     ObjectEnabled saving{true, true, true};
     ObjectEnabled display{true, true, true};
 
   public:
     sf::View         view;
-    RingBuffer<Vec2> fps = RingBuffer<Vec2>(160);
+    RingBuffer<Vec2>  fps        = RingBuffer<Vec2>(160);
+    bool              loaded     = false; // a scene was loaded this frame
+    bool              openPanels = false; // start every panel open (the bench builds them all)
+    AllocationMonitor allocations;
+    QualityGovernor   governor;
+    double            drawTime = 0.0; // last visual frame from after the sim steps to display (s)
 
     GUI(EntityManager& entities_, const sf::VideoMode& desktop, sf::RenderWindow& window_,
         float radius_ = 0.05F)
         : screen(desktop.width, desktop.height), vsScale(static_cast<float>(screen.x) / 20.0F),
           entities(entities_), window(window_), radius(radius_) {
         std::cout << "Scale: " << vsScale << "\n";
-        if (!pointTexture.loadFromFile("point.png"))
-            throw std::logic_error("failed to load point texture");
-        pointTexture.setSmooth(true);
+        if (window.isOpen()) { // headless (the bench) draws nothing, and has no GL for textures
+            if (!pointTexture.loadFromFile("point.png"))
+                throw std::logic_error("failed to load point texture");
+            pointTexture.setSmooth(true);
+        }
         resetView();
     }
 
@@ -118,9 +210,10 @@ class GUI {
     }
 
     // called every visual frame
-    void frame(const sf::Vector2i& mousePixPos, Sim& sim, GraphManager& graphs, bool running) {
-        interface(mousePixPos, sim, graphs, running);
-        if (sf::Mouse::isButtonPressed(sf::Mouse::Middle)) {
+    void frame(const sf::Vector2i& mousePixPos, Sim& sim, Solver& solver, GraphManager& graphs,
+               RunClock& runClock, History& history, TrajectoryRecorder& recorder, bool running) {
+        interface(mousePixPos, sim, solver, graphs, runClock, history, recorder, running);
+        if (window.hasFocus() && sf::Mouse::isButtonPressed(sf::Mouse::Middle)) {
             ImGui::SetMouseCursor(ImGuiMouseCursor_ResizeAll);
             if (!mousePosLast)
                 mousePosLast = mousePixPos;
@@ -135,8 +228,16 @@ class GUI {
         }
     }
 
+    // header of a settings panel
+    bool panel(const char* label) const {
+        if (openPanels) ImGui::SetNextItemOpen(true, ImGuiCond_Once);
+        return ImGui::CollapsingHeader(label);
+    }
+
     // generates the settings menu
-    void interface(const sf::Vector2i& mousePixPos, Sim& sim, GraphManager& graphs, bool running) {
+    void interface(const sf::Vector2i& mousePixPos, Sim& sim, Solver& solver, GraphManager& graphs,
+                   RunClock& runClock, History& history, TrajectoryRecorder& recorder,
+                   bool running) {
         ImGui::Begin("Settings", NULL,
                      ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoBackground |
                          ImGuiWindowFlags_NoResize);
@@ -144,7 +245,11 @@ class GUI {
         ImGui::SetWindowSize({-1.0F, -1.0F}, ImGuiCond_Always);
         ImGui::SetWindowPos({0.0F, 0.0F}, ImGuiCond_Once);
 
-        if (ImGui::CollapsingHeader("Save and load")) {
+        governor.update(drawTime);
+        const Quality& quality = governor.quality();
+        graphs.stride          = quality.graphStride;
+
+        if (panel("Save and load")) {
             if (running) ImGui::BeginDisabled();
             static char arr[20]{};
             const auto  firstInvalid =
@@ -152,8 +257,6 @@ class GUI {
             const auto end = std::find(&arr[0], &arr[20], '\0');
             const bool isValid =
                 (firstInvalid == &arr[20] || firstInvalid >= end) && end - &arr[0] != 0;
-            fs::path savePath{arr};
-            savePath = "sims/" + savePath.string() + ".csv";
 
             ImGui::BulletText("Saving");
             ImGui::Indent(10.0F);
@@ -172,11 +275,15 @@ class GUI {
                     ImGui::TextColored(ImVec4{1, 0, 0, 1}, "File name has no characters! :(");
                 }
             } else {
-                ImGui::Text("Path: %s", savePath.string().c_str());
+                ImGui::Text("Path: sims/%s.csv", arr);
             }
             if (!isValid) ImGui::BeginDisabled();
             if (ImGui::Button("Save")) {
+                TraceSpan      span("save");
+                const fs::path savePath = "sims/" + std::string{arr} + ".csv";
                 sim.save(savePath, saving);
+                solver.saveSettings(savePath);
+                sims.invalidate(); // an overwrite doesn't change the directory for polling
             }
             if (!isValid) ImGui::EndDisabled();
             ImGui::Unindent(10.0F);
@@ -192,38 +299,25 @@ class GUI {
             ImGui::SameLine();
             HelpMarker("Overrite enabled will delete the current sim before loading the new one");
 
-            std::vector<fs::directory_entry> files;
-            for (const auto& entry: fs::directory_iterator(fs::path{"sims"}))
-                if (entry.path().extension() == ".csv") files.push_back(entry);
-            std::sort(files.begin(), files.end(), [](const auto& lhs, const auto& rhs) {
-                return lhs.last_write_time() > rhs.last_write_time();
-            });
-
-            static std::size_t current = 0;
-            float              height  = ImGui::GetTextLineHeightWithSpacing() *
-                               std::min(10.0F, static_cast<float>(files.size())) +
-                           2.0F;
-            if (ImGui::BeginListBox("File", {440.0f, height})) {
-                for (std::size_t i = 0; i < files.size(); ++i) {
-                    const bool is_selected = current == i;
-                    if (ImGui::Selectable(files[i].path().stem().string().c_str(), is_selected))
-                        current = i;
-                    ImGui::SameLine(160.0F);
-                    display_size(files[i]);
-                    ImGui::SameLine(240.0F);
-                    ImGui::Text("%s", to_string(files[i].last_write_time()).c_str());
-                    if (is_selected) ImGui::SetItemDefaultFocus();
+            fileListBox("File", sims, 10.0F, true);
+            if (ImGui::Button("Load") && sims.selection()) {
+                TraceSpan span("load");
+                try {
+                    sim.load(sims.selection()->path, overwrite, loading);
+                    solver.loadSettings(sims.selection()->path);
+                    loadError.clear();
+                } catch (const std::exception& e) {
+                    loadError = e.what();
                 }
-                ImGui::EndListBox();
-            }
-            if (ImGui::Button("Load") &&
-                current < files.size()) { // prevents old selection breaking the load
-                sim.load(files[current].path(), overwrite, loading);
+                entities.stepBound.invalidate(); // even a failed load may have changed the scene
+                loaded = true;
             }
+            if (!loadError.empty())
+                ImGui::TextColored(ImVec4{1, 0, 0, 1}, "%s", loadError.c_str());
             ImGui::Unindent(10.0F);
             if (running) ImGui::EndDisabled();
         }
-        if (ImGui::CollapsingHeader("General")) {
+        if (panel("General")) {
             if (running) ImGui::BeginDisabled();
             ImGui::SetNextItemWidth(100.0F);
             ImGui_DragDouble("Gravity", &sim.gravity, 0.001F, -100, 100, "%.3f",
@@ -238,27 +332,475 @@ class GUI {
                        "many visual frames occur before old data is overwritten. This value is "
                        "updated "
                        "on run.");
+            ImGui::SetNextItemWidth(100.0F);
+            int integrator = static_cast<int>(solver.integrator);
+            ImGui::Combo("Integrator", &integrator, IntegratorLbl.data(), IntegratorLbl.size());
+            solver.integrator = static_cast<Integrator>(integrator);
+            ImGui::SameLine();
+            HelpMarker("Explicit steps with the (wall clock) frame time and needs tiny steps for "
+                       "stiff springs. Implicit (backward euler) is stable at much larger fixed "
+                       "steps but damps high frequencies. XPBD treats springs as distance "
+                       "constraints and is stable at any step. Adaptive picks its own step from an "
+                       "error tolerance. Multi-rate substeps stiff parts of the scene more often "
+                       "than soft ones. Saved with the scene.");
+            const double stableStep = entities.stableStep();
+            if (stableStep == std::numeric_limits<double>::infinity())
+                ImGui::Text("Stable step: any");
+            else
+                ImGui::Text("Stable step: %.3g s", stableStep);
+            ImGui::SameLine();
+            HelpMarker("Largest step explicit integration (and multi-rate's finest substep) is "
+                       "stable at, from the stiffness and damping of each point's springs over "
+                       "its mass with a 10% margin. Explicit runs clamp their steps to it.");
+            if (const std::optional<double> finest = solver.finestStep(runClock.nominalStep());
+                finest && *finest > stableStep) {
+                if (solver.integrator == Integrator::Explicit)
+                    ImGui::TextColored(ImVec4{1, 0.5F, 0, 1}, "Steps of %.3g s will be clamped",
+                                       *finest);
+                else
+                    ImGui::TextColored(ImVec4{1, 0, 0, 1}, "Finest step %.3g s will blow up",
+                                       *finest);
+            }
+            if (solver.integrator != Integrator::Explicit) {
+                ImGui::SetNextItemWidth(100.0F);
+                ImGui_DragDouble("Step size", &solver.stepSize, 0.0001F, 0.0001, 0.1, "%.4f",
+                                 ImGuiSliderFlags_AlwaysClamp);
+            }
+            if (solver.integrator == Integrator::XPBD) {
+                ImGui::SetNextItemWidth(100.0F);
+                auto substeps = static_cast<std::uint32_t>(solver.substeps);
+                ImGui_DragUnsigned("Substeps", &substeps, 0.1F, 1, 1000, "%u",
+                                   ImGuiSliderFlags_AlwaysClamp);
+                solver.substeps = substeps;
+                ImGui::SetNextItemWidth(100.0F);
+                auto iterations = static_cast<std::uint32_t>(solver.iterations);
+                ImGui_DragUnsigned("Iterations", &iterations, 0.1F, 1, 100, "%u",
+                                   ImGuiSliderFlags_AlwaysClamp);
+                solver.iterations = iterations;
+                ImGui::SetNextItemWidth(100.0F);
+                int solve = static_cast<int>(solver.constraintSolve);
+                ImGui::Combo("Constraints", &solve, ConstraintSolveLbl.data(),
+                             ConstraintSolveLbl.size());
+                solver.constraintSolve = static_cast<ConstraintSolve>(solve);
+                ImGui::SameLine();
+                HelpMarker("Gauss-Seidel solves springs in batches that share no points (graph "
+                           "colours) and converges fastest. Jacobi solves all springs at once and "
+                           "averages the moves.");
+            }
+            if (solver.integrator == Integrator::Adaptive) {
+                ImGui::SetNextItemWidth(100.0F);
+                ImGui_DragDouble("Tolerance", &solver.tolerance, 1e-7F, 1e-9, 1e-1, "%.1e",
+                                 ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+                ImGui::SameLine();
+                HelpMarker("Largest error (m and m/s) allowed per step. Steps grow while calm and "
+                           "shrink through impacts, never past the stiffest springs stability "
+                           "bound or the step size.");
+            }
+            if (solver.integrator == Integrator::MultiRate) {
+                ImGui::SetNextItemWidth(100.0F);
+                auto maxLevel = static_cast<std::uint32_t>(solver.maxRateLevel);
+                ImGui_DragUnsigned("Max level", &maxLevel, 0.05F, 0, 16, "%u",
+                                   ImGuiSliderFlags_AlwaysClamp);
+                solver.maxRateLevel = maxLevel;
+                ImGui::SameLine();
+                HelpMarker("Each point steps 2^level times per step, picked from the stiffness "
+                           "and damping of its springs over its mass. Points at the max level "
+                           "may still be unstable, lower the step size if so.");
+            }
+            ImGui::Checkbox("Renumber", &entities.autoRenumber);
+            ImGui::SameLine();
+            HelpMarker("Reorders points and springs in memory (reverse Cuthill-McKee) so connected "
+                       "points are stored together, done on run and load. Faster for big scenes "
+                       "built up over many edits.");
             if (running) ImGui::EndDisabled();
+            if (ImGui::Checkbox("Sleeping", &solver.islands.sleeping) && !solver.islands.sleeping)
+                solver.islands.wakeAll();
+            ImGui::SameLine();
+            HelpMarker("Bodies (points connected by springs) that stay at rest for the sleep time "
+                       "stop being simulated until something comes near them. Saved with the "
+                       "scene.");
+            if (solver.islands.sleeping) {
+                ImGui::SetNextItemWidth(100.0F);
+                ImGui_DragDouble("Sleep energy", &solver.islands.sleepEnergy, 1e-6F, 0.0, 1.0,
+                                 "%.1e",
+                                 ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+                ImGui::SetNextItemWidth(100.0F);
+                ImGui_DragDouble("Sleep time", &solver.islands.sleepTime, 0.01F, 0.0, 10.0, "%.2f",
+                                 ImGuiSliderFlags_AlwaysClamp);
+                ImGui::Text("Islands: %zu asleep: %zu", solver.islands.count(),
+                            solver.islands.asleep());
+            }
+            PointCollider& collider = solver.collider;
+            ImGui::Checkbox("Point collisions", &collider.enabled);
+            ImGui::SameLine();
+            HelpMarker("Points of different bodies bounce off each other as discs of the "
+                       "collision radius times the square root of their mass. Points of the same "
+                       "body don't collide. Saved with the scene.");
+            if (collider.enabled) {
+                ImGui::SetNextItemWidth(100.0F);
+                ImGui_DragDouble("Collision radius", &collider.radius, 0.001F, 0.001, 10.0, "%.3f",
+                                 ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+                ImGui::SetNextItemWidth(100.0F);
+                ImGui_DragDouble("Restitution", &collider.restitution, 0.01F, 0.0, 1.0, "%.2f",
+                                 ImGuiSliderFlags_AlwaysClamp);
+                ImGui::SetNextItemWidth(100.0F);
+                auto threads = static_cast<std::uint32_t>(collider.threads());
+                ImGui_DragUnsigned("Collision threads", &threads, 0.05F, 1, 256, "%u",
+                                   ImGuiSliderFlags_AlwaysClamp);
+                collider.setThreads(threads);
+                ImGui::Text("Contacts: %zu", collider.contacts);
+            }
+            ImGui::SetNextItemWidth(100.0F);
+            ImGui_DragDouble("Wall restitution", &solver.surface.restitution, 0.01F, 0.0, 1.0,
+                             "%.2f", ImGuiSliderFlags_AlwaysClamp);
+            ImGui::SetNextItemWidth(100.0F);
+            ImGui_DragDouble("Wall friction", &solver.surface.friction, 0.01F, 0.0, 2.0, "%.2f",
+                             ImGuiSliderFlags_AlwaysClamp);
+            ImGui::SameLine();
+            HelpMarker("Fraction of the speed into a polygon kept after bouncing off it, and how "
+                       "much of the bounce is taken off the speed along it. Saved with the "
+                       "scene.");
+            ImGui::SetNextItemWidth(100.0F);
+            ImGui_DragDouble("Grab response", &solver.grab.responseTime, 0.001F, 0.001, 1.0,
+                             "%.3f s", ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+            ImGui::SameLine();
+            HelpMarker("While running, dragging with the left mouse button pulls the closest point "
+                       "towards the cursor. This is about how long it takes to catch up, the pull "
+                       "is never faster than the integrator's step allows.");
+            if (solver.integrator == Integrator::Implicit)
+                ImGui::Text("CG iterations: %zu", solver.lastCgIters);
+            if (solver.integrator == Integrator::XPBD)
+                ImGui::Text("Spring colours: %zu", solver.colors());
+            if (solver.integrator == Integrator::MultiRate) {
+                for (std::size_t l = 0; l != solver.levels(); ++l) {
+                    if (solver.levelCount(l) != 0)
+                        ImGui::Text("Level %zu (%zu substeps): %zu points", l, std::size_t{1} << l,
+                                    solver.levelCount(l));
+                }
+            }
+            if (solver.integrator == Integrator::Adaptive) {
+                ImGui::Text("Step: %.2e s (bound %.2e s)", solver.adaptiveDt,
+                            entities.stableStep());
+                ImGui::Text("Steps accepted: %zu rejected: %zu", solver.acceptedSteps,
+                            solver.rejectedSteps);
+                if (solver.blownUpSteps != 0)
+                    ImGui::TextColored(ImVec4{1, 0, 0, 1}, "Blown up steps: %zu",
+                                       solver.blownUpSteps);
+            }
         }
 
-        if (ImGui::CollapsingHeader("Graphics")) {
+        if (panel("Run")) {
+            ImGui::SetNextItemWidth(100.0F);
+            int mode = static_cast<int>(runClock.mode);
+            ImGui::Combo("Mode", &mode, RunModeLbl.data(), RunModeLbl.size());
+            runClock.mode = static_cast<RunMode>(mode);
+            ImGui::SameLine();
+            HelpMarker("Realtime keeps sim time in step with the wall clock. Turbo takes fixed "
+                       "steps as fast as possible. Speed runs at a multiple of realtime (as far as "
+                       "the machine keeps up). Advance runs turbo for a set sim time then stops.");
+            if (running) ImGui::BeginDisabled();
+            ImGui::Checkbox("Deterministic", &runClock.deterministic);
+            if (running) ImGui::EndDisabled();
+            ImGui::SameLine();
+            HelpMarker("Every mode takes fixed steps of the sim step so the same scene always "
+                       "ends in the same state. A hash of the state is printed when the run "
+                       "stops.");
+            if (runClock.mode == RunMode::Turbo || runClock.mode == RunMode::Advance ||
+                runClock.deterministic) {
+                ImGui::SetNextItemWidth(100.0F);
+                ImGui_DragDouble("Sim step", &runClock.turboStep, 0.00001F, 0.000001,
+                                 RunClock::stepLimit, "%.6f",
+                                 ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+            } else {
+                ImGui::SetNextItemWidth(100.0F);
+                ImGui_DragDouble("Max step", &runClock.maxStep, 0.00001F, 0.000001,
+                                 RunClock::stepLimit, "%.6f",
+                                 ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+                ImGui::SameLine();
+                HelpMarker("Longest step realtime and speed take when the frame time is longer. "
+                           "Collisions with polygons are swept so they hold at any step, the "
+                           "springs' stability still limits how big it can be.");
+            }
+            if (runClock.mode == RunMode::Speed) {
+                ImGui::SetNextItemWidth(100.0F);
+                ImGui_DragDouble("Speed", &runClock.speed, 0.01F, 0.01, 1000.0, "%.2fx",
+                                 ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+            }
+            if (runClock.mode == RunMode::Advance) {
+                if (running) ImGui::BeginDisabled();
+                ImGui::SetNextItemWidth(100.0F);
+                ImGui_DragDouble("Sim time", &runClock.advanceTime, 0.1F, 0.001, 1e6, "%.3f s",
+                                 ImGuiSliderFlags_AlwaysClamp);
+                if (running) ImGui::EndDisabled();
+            }
+            ImGui::Text("Sim time: %.3f s wall time: %.3f s", runClock.simTime, runClock.wallTime);
+            ImGui::Text("Sim / wall: %.2f steps/s: %.3g", runClock.ratio(),
+                        runClock.stepsPerSecond());
+            ImGui::BulletText("History");
+            if (history.frames() != 0) {
+                if (running) ImGui::BeginDisabled();
+                int frame = static_cast<int>(history.position);
+                ImGui::SetNextItemWidth(300.0F);
+                if (ImGui::SliderInt("Timeline", &frame, 0, static_cast<int>(history.frames()) - 1,
+                                     "", ImGuiSliderFlags_AlwaysClamp)) {
+                    history.restore(static_cast<std::size_t>(frame), entities);
+                    runClock.simTime = history.time(history.position);
+                }
+                if (running) ImGui::EndDisabled();
+                ImGui::SameLine();
+                HelpMarker("Scrub back through the run while paused, running again resumes from "
+                           "the shown moment and forgets what came after it.");
+                ImGui::Text("%.3f s of %.3f s to %.3f s", history.time(history.position),
+                            history.time(0), history.time(history.frames() - 1));
+            }
+            ImGui::SetNextItemWidth(100.0F);
+            auto budget = static_cast<std::uint32_t>(history.budget >> 20);
+            ImGui_DragUnsigned("Budget", &budget, 1.0F, 1, 16384, "%u MB",
+                               ImGuiSliderFlags_AlwaysClamp);
+            history.budget = std::size_t{budget} << 20;
+            ImGui::SameLine();
+            ImGui::Text("%zu frames, %.1f MB", history.frames(),
+                        static_cast<double>(history.bytes()) / (1 << 20));
+        }
+
+        if (panel("Trajectories")) {
+            ImGui::BulletText("Recording");
+            ImGui::Indent(10.0F);
+            if (recorder.isRecording()) ImGui::BeginDisabled();
+            ImGui::SetNextItemWidth(100.0F);
+            ImGui_DragDouble("Interval", &recorder.interval, 0.001F, 0.0, 10.0, "%.3f s",
+                             ImGuiSliderFlags_AlwaysClamp);
+            ImGui::Checkbox("Quantize", &recorder.quantize);
+            ImGui::SameLine();
+            HelpMarker("Stores floats instead of doubles, halving the file size.");
+            if (recorder.isRecording()) ImGui::EndDisabled();
+            if (!recorder.isRecording()) {
+                if (ImGui::Button("Start recording"))
+                    recorder.start("trajectories/" + timestamp() + ".traj", entities);
+            } else {
+                if (ImGui::Button("Stop recording")) {
+                    recorder.stop();
+                    recordings.invalidate(); // trimmed
+                }
+                ImGui::SameLine();
+                ImGui::Text("%zu frames", recorder.frames());
+            }
+            ImGui::SameLine();
+            HelpMarker("Records every point's position and velocity at the interval (sim time) "
+                       "while running into trajectories/, for replay or offline analysis.");
+            ImGui::Unindent(10.0F);
+
+            ImGui::BulletText("Replay");
+            ImGui::Indent(10.0F);
+            if (running) ImGui::BeginDisabled();
+            fileListBox("Recording", recordings, 5.0F, false);
+            if (ImGui::Button("Open") && recordings.selection()) {
+                try {
+                    replay.emplace(recordings.selection()->path);
+                    replayError.clear();
+                } catch (const std::exception& e) {
+                    replayError = e.what();
+                }
+                replayTime    = replay && replay->frames() != 0 ? replay->time(0) : 0.0;
+                replayPlaying = false;
+                replayFrame.reset();
+            }
+            if (!replayError.empty())
+                ImGui::TextColored(ImVec4{1, 0, 0, 1}, "%s", replayError.c_str());
+            if (replay) {
+                ImGui::SameLine();
+                if (ImGui::Button("Close")) replay.reset();
+            }
+            if (replay && replay->frames() != 0) {
+                if (replay->points() != entities.points.size()) {
+                    ImGui::TextColored(ImVec4{1, 0, 0, 1},
+                                       "Recording has %zu points, the scene has %zu",
+                                       replay->points(), entities.points.size());
+                } else {
+                    if (ImGui::Button(replayPlaying ? "Pause" : "Play"))
+                        replayPlaying = !replayPlaying;
+                    ImGui::SameLine();
+                    ImGui::SetNextItemWidth(100.0F);
+                    ImGui_DragDouble("Speed##replay", &replaySpeed, 0.01F, 0.01, 1000.0, "%.2fx",
+                                     ImGuiSliderFlags_AlwaysClamp | ImGuiSliderFlags_Logarithmic);
+                    const double start = replay->time(0);
+                    const double end   = replay->time(replay->frames() - 1);
+                    if (replayPlaying && !running) {
+                        replayTime += static_cast<double>(ImGui::GetIO().DeltaTime) * replaySpeed;
+                        if (replayTime >= end) replayPlaying = false;
+                    }
+                    ImGui::SetNextItemWidth(300.0F);
+                    ImGui_DragDouble("Time##replay", &replayTime, 0.01F, start, end, "%.3f s",
+                                     ImGuiSliderFlags_AlwaysClamp);
+                    // only when the frame changes, so runs and edits in between aren't overwritten
+                    const std::size_t frame = replay->frameAt(replayTime);
+                    if (!running && frame != replayFrame) {
+                        replay->load(frame, entities);
+                        replayFrame = frame;
+                    }
+                }
+            }
+            if (running) ImGui::EndDisabled();
+            ImGui::Unindent(10.0F);
+        }
+
+        if (panel("Sweep")) {
+            const bool sweeping = sweep.isRunning();
+            if (sweeping) ImGui::BeginDisabled();
+            ImGui::BulletText("Parameters");
+            ImGui::SameLine();
+            HelpMarker("Every variant of the scene runs headless with these overrides (on every "
+                       "spring or free point), a grid of count values per parameter or random "
+                       "samples between min and max. The scene's graphs are the measured "
+                       "metrics.");
+            ImGui::Indent(10.0F);
+            for (std::size_t i = 0; i < sweep.axes.size(); ++i) {
+                SweepAxis& axis = sweep.axes[i];
+                ImGui::PushID(static_cast<int>(i));
+                ImGui::SetNextItemWidth(110.0F);
+                int param = static_cast<int>(axis.param);
+                ImGui::Combo("##param", &param, SweepParamLbl.data(), SweepParamLbl.size());
+                axis.param = static_cast<SweepParam>(param);
+                const SweepLimits limits = getSweepParamLimits(axis.param);
+                axis.min                 = std::clamp(axis.min, limits.min, limits.max);
+                axis.max                 = std::clamp(axis.max, limits.min, limits.max);
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(80.0F);
+                ImGui_DragDouble("##min", &axis.min, 0.1F, limits.min, limits.max, "%.4g",
+                                 ImGuiSliderFlags_AlwaysClamp);
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(80.0F);
+                ImGui_DragDouble("##max", &axis.max, 0.1F, limits.min, limits.max, "%.4g",
+                                 ImGuiSliderFlags_AlwaysClamp);
+                if (!sweep.random) {
+                    ImGui::SameLine();
+                    ImGui::SetNextItemWidth(50.0F);
+                    auto count = static_cast<std::uint32_t>(axis.count);
+                    ImGui_DragUnsigned("##count", &count, 0.1F, 1, 1000, "%u",
+                                       ImGuiSliderFlags_AlwaysClamp);
+                    axis.count = count;
+                }
+                ImGui::SameLine();
+                const bool remove = ImGui::Button("X");
+                if (!axis.valid()) {
+                    ImGui::SameLine();
+                    ImGui::TextColored(ImVec4{1, 0, 0, 1}, "Min is above max");
+                }
+                ImGui::PopID();
+                if (remove) {
+                    sweep.axes.erase(sweep.axes.begin() + static_cast<long>(i));
+                    break;
+                }
+            }
+            if (ImGui::Button("Add parameter")) sweep.axes.emplace_back();
+            ImGui::Unindent(10.0F);
+
+            ImGui::Checkbox("Random", &sweep.random);
+            if (sweep.random) {
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(80.0F);
+                auto samples = static_cast<std::uint32_t>(sweep.samples);
+                ImGui_DragUnsigned("Samples", &samples, 1.0F, 1, 100000, "%u",
+                                   ImGuiSliderFlags_AlwaysClamp);
+                sweep.samples = samples;
+            }
+            ImGui::SetNextItemWidth(100.0F);
+            ImGui_DragDouble("Duration", &sweep.duration, 0.1F, 0.001, 1e5, "%.3f s",
+                             ImGuiSliderFlags_AlwaysClamp);
+            ImGui::SetNextItemWidth(100.0F);
+            ImGui_DragDouble("Step##sweep", &sweep.step, 0.00001F, 0.000001, RunClock::stepLimit,
+                             "%.6f", ImGuiSliderFlags_AlwaysClamp);
+            ImGui::SetNextItemWidth(100.0F);
+            auto threads = static_cast<std::uint32_t>(sweep.threads);
+            ImGui_DragUnsigned("Threads", &threads, 0.1F, 1, 256, "%u",
+                               ImGuiSliderFlags_AlwaysClamp);
+            sweep.threads = threads;
+            const bool valid = std::all_of(sweep.axes.begin(), sweep.axes.end(),
+                                           [](const SweepAxis& axis) { return axis.valid(); });
+            if (!valid) ImGui::BeginDisabled();
+            if (ImGui::Button("Start sweep"))
+                sweep.start(entities, solver, sim.gravity); // copies the scene
+            if (!valid) ImGui::EndDisabled();
+            ImGui::SameLine();
+            ImGui::Text("%zu variants", sweep.variants());
+            if (sweeping) ImGui::EndDisabled();
+            if (sweeping) {
+                ImGui::ProgressBar(static_cast<float>(sweep.done()) /
+                                       static_cast<float>(sweep.variants()),
+                                   {300.0F, 0.0F},
+                                   frameArena.format("%zu/%zu", sweep.done(), sweep.variants()));
+                ImGui::SameLine();
+                if (ImGui::Button("Cancel")) sweep.cancel();
+            } else if (!sweep.output().empty()) {
+                ImGui::Text("Results: %s", sweep.output().c_str());
+            }
+        }
+
+        if (panel("Graphics")) {
             fpsGraph();
             enabledCheckBoxes(display, entities, "display");
             ImGui::SameLine();
             HelpMarker("Enable and disable which items are displayed (usefull for laggy scenes)");
+            ImGui::Checkbox("Auto quality", &governor.enabled);
+            ImGui::SameLine();
+            HelpMarker("Lowers the drawing detail a step at a time (skipping tiny springs, "
+                       "thinning springs, merging points into density splats and plotting fewer "
+                       "graph samples) while drawing a frame takes longer than the target frame "
+                       "time (time spent stepping the sim isn't counted), and restores it when "
+                       "there is headroom again.");
+            if (governor.enabled) {
+                ImGui::SetNextItemWidth(100.0F);
+                ImGui_DragDouble("Target fps", &governor.targetFps, 1.0F, 10.0, 100.0, "%.0f",
+                                 ImGuiSliderFlags_AlwaysClamp);
+                ImGui::Text("Level %zu: %s", governor.level, quality.description);
+            }
+            ImGui::Checkbox("Level of detail", &lod);
+            ImGui::SameLine();
+            HelpMarker("Bodies smaller than the LOD size on screen are drawn as their outline "
+                       "instead of every spring and point.");
+            if (lod) {
+                ImGui::SetNextItemWidth(100.0F);
+                ImGui::DragFloat("LOD size", &lodPixels, 1.0F, 1.0F, 1000.0F, "%.0f px",
+                                 ImGuiSliderFlags_AlwaysClamp);
+            }
             ImGui::SetNextItemWidth(100.0F);
             ImGui::DragFloat("Point Radius", &radius, 0.001F, 0.005F, 100000, "%.3f",
                              ImGuiSliderFlags_AlwaysClamp);
         }
 
-        if (display.springs) {
-            entities.updateSpringVisPos();
-            window.draw(entities.springVerts.data(), entities.springVerts.size(), sf::Lines);
+        if (panel("Profiling")) {
+            if (!Trace::isRecording()) {
+                if (ImGui::Button("Start trace")) Trace::start();
+            } else if (ImGui::Button("Stop trace")) {
+                Trace::stop("tracedata/" + timestamp() + ".json");
+            }
+            ImGui::SameLine();
+            HelpMarker("Records sim, frame, save/load and tool timings between start and stop into "
+                       "tracedata/ as a chrome trace (open with ui.perfetto.dev or "
+                       "chrome://tracing). Also startable with --trace <file>.");
+            ImGui::BulletText("Allocations");
+            ImGui::SameLine();
+            HelpMarker("Heap allocations of the main thread in the last visual frame and the "
+                       "number of frames which allocated once a run was past its warm up frames "
+                       "(should stay 0). Run with --check-allocations to print them, with "
+                       "--bench <scene> too it runs headless and exits with 1 if any frame "
+                       "allocated. The histogram is every allocation so far by size (bucket n "
+                       "is up to 2^n bytes, log10 counts).");
+            ImGui::Text("Last frame: %llu steady state frames allocating: %zu",
+                        static_cast<unsigned long long>(allocations.last), allocations.badFrames);
+            allocationHistogram(histogram);
+            for (std::size_t b = 0; b != allocationBuckets; ++b)
+                histogramPlot[b] = std::log10(static_cast<float>(histogram[b]) + 1.0F);
+            ImGui::PlotHistogram("Sizes", histogramPlot.data(), allocationBuckets, 0, nullptr,
+                                 0.0F, 10.0F, {300.0F, 80.0F});
         }
-        if (display.points) {
-            entities.updatePointVisPos(radius);
-            window.draw(entities.pointVerts.data(), entities.pointVerts.size(), sf::Quads,
-                        &pointTexture);
+
+        updateLod(solver.islands);
+        if (display.springs) drawSprings(quality, solver.islands);
+        if (display.points) drawPoints(quality, solver.islands);
+        if (anyHull && (display.springs || display.points)) {
+            window.draw(hullFill.data(), hullFill.size(), sf::Triangles);
+            window.draw(hullLines.data(), hullLines.size(), sf::Lines);
         }
         if (display.polygons) {
             for (Polygon& poly: entities.polys) poly.draw(window, false);
@@ -272,13 +814,146 @@ class GUI {
         ImGui::SameLine();
         HelpMarker("Resets the view to default");
         if (running) ImGui::BeginDisabled();
-        if (ImGui::Button("Reset sim")) sim.reset();
+        if (ImGui::Button("Reset sim")) {
+            sim.reset();
+            entities.stepBound.invalidate();
+        }
         if (running) ImGui::EndDisabled();
         ImGui::SameLine();
         HelpMarker("Resets the sim to last starting point - r");
         ImGui::End();
     }
 
+    bool isDetailed(std::size_t island) const {
+        return island == Islands::none || detailed[island] != 0;
+    }
+
+    // picks the bodies drawn in full and builds the outline hulls of the rest
+    void updateLod(Islands& islands) {
+        islands.refresh(entities);
+        detailed.assign(islands.count(), 1);
+        hullFill.clear();
+        hullLines.clear();
+        anyHull = false;
+        if (!lod) return;
+        const float minSize = lodPixels * view.getSize().x / static_cast<float>(screen.x);
+        for (std::size_t island = 0; island != islands.count(); ++island) {
+            const std::span<const std::size_t> points = islands.points(island);
+            if (points.size() < lodMinPoints) continue;
+            hullPoints.clear();
+            sf::Vector2f min{std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+            sf::Vector2f max = -min;
+            for (const std::size_t p: points) {
+                const sf::Vector2f pos = visualize(entities.points[p].pos);
+                // blown up points would break the hull's sort (nan isn't ordered)
+                if (!std::isfinite(pos.x) || !std::isfinite(pos.y)) continue;
+                min = {std::min(min.x, pos.x), std::min(min.y, pos.y)};
+                max = {std::max(max.x, pos.x), std::max(max.y, pos.y)};
+                hullPoints.push_back(pos);
+            }
+            if (hullPoints.size() < 3 || std::max(max.x - min.x, max.y - min.y) >= minSize)
+                continue;
+            detailed[island] = 0;
+            anyHull          = true;
+            convexHull(hullPoints, hull);
+            sf::Color colour = entities.pointVerts[points[0] * 4].color;
+            for (std::size_t k = 0; k != hull.size(); ++k) {
+                hullLines.emplace_back(hull[k], colour);
+                hullLines.emplace_back(hull[(k + 1) % hull.size()], colour);
+            }
+            colour.a = 96;
+            for (std::size_t k = 1; k + 1 < hull.size(); ++k) { // fan
+                hullFill.emplace_back(hull[0], colour);
+                hullFill.emplace_back(hull[k], colour);
+                hullFill.emplace_back(hull[k + 1], colour);
+            }
+        }
+    }
+
+    // springs of the detailed bodies, thinned out for the quality level
+    void drawSprings(const Quality& quality, const Islands& islands) {
+        entities.updateSpringVisPos();
+        if (!anyHull && quality.minSpringPixels == 0.0F && quality.springStride == 1) {
+            window.draw(entities.springVerts.data(), entities.springVerts.size(), sf::Lines);
+            return;
+        }
+        const float minLength =
+            quality.minSpringPixels * view.getSize().x / static_cast<float>(screen.x);
+        springDraw.clear();
+        for (std::size_t i = 0; i < entities.springs.size(); i += quality.springStride) {
+            if (anyHull && !isDetailed(islands.islandOf(entities.springs[i]))) continue;
+            const sf::Vertex&  v1   = entities.springVerts[i * 2];
+            const sf::Vertex&  v2   = entities.springVerts[i * 2 + 1];
+            const sf::Vector2f diff = v2.position - v1.position;
+            if (diff.x * diff.x + diff.y * diff.y < minLength * minLength) continue;
+            springDraw.push_back(v1);
+            springDraw.push_back(v2);
+        }
+        window.draw(springDraw.data(), springDraw.size(), sf::Lines);
+    }
+
+    // points of the detailed bodies
+    void drawPoints(const Quality& quality, const Islands& islands) {
+        entities.updatePointVisPos(radius);
+        if (quality.splats) {
+            drawSplats(islands);
+            return;
+        }
+        if (!anyHull) {
+            window.draw(entities.pointVerts.data(), entities.pointVerts.size(), sf::Quads,
+                        &pointTexture);
+            return;
+        }
+        pointDraw.clear();
+        for (std::size_t i = 0; i != entities.points.size(); ++i) {
+            if (!isDetailed(islands.islandOf(i))) continue;
+            const auto quad = entities.pointVerts.begin() + static_cast<std::ptrdiff_t>(i * 4);
+            pointDraw.insert(pointDraw.end(), quad, quad + 4);
+        }
+        window.draw(pointDraw.data(), pointDraw.size(), sf::Quads, &pointTexture);
+    }
+
+    // merges the visible points into one quad per occupied cell of a splatPixels screen grid,
+    // more opaque the more points it holds
+    void drawSplats(const Islands& islands) {
+        const sf::Vector2f size   = view.getSize();
+        const sf::Vector2f corner = view.getCenter() - size / 2.0F;
+        const float        cell   = splatPixels * size.x / static_cast<float>(screen.x);
+        const auto         cols   = static_cast<std::size_t>(size.x / cell) + 1;
+        const auto         rows   = static_cast<std::size_t>(size.y / cell) + 1;
+        splatCounts.assign(cols * rows, 0);
+        splatCells.clear();
+        splatVerts.clear();
+        for (std::size_t i = 0; i != entities.points.size(); ++i) {
+            if (!isDetailed(islands.islandOf(i))) continue;
+            const sf::Vector2f pos = visualize(entities.points[i].pos) - corner;
+            // blown up points pass the bounds check below (nan compares false) and have no cell
+            if (!std::isfinite(pos.x) || !std::isfinite(pos.y)) continue;
+            if (pos.x < 0 || pos.y < 0 || pos.x >= size.x || pos.y >= size.y) continue;
+            const std::size_t c = static_cast<std::size_t>(pos.y / cell) * cols +
+                                  static_cast<std::size_t>(pos.x / cell);
+            if (splatCounts[c]++ == 0) {
+                splatCells.push_back(c);
+                // colour of the first point, the alpha is set once the cell is counted
+                const sf::Vector2f at =
+                    corner + sf::Vector2f{static_cast<float>(c % cols) * cell,
+                                          static_cast<float>(c / cols) * cell};
+                const sf::Color colour = entities.pointVerts[i * 4].color;
+                splatVerts.emplace_back(at, colour, sf::Vector2f{0, 0});
+                splatVerts.emplace_back(at + sf::Vector2f{cell, 0}, colour, sf::Vector2f{300, 0});
+                splatVerts.emplace_back(at + sf::Vector2f{cell, cell}, colour,
+                                        sf::Vector2f{300, 300});
+                splatVerts.emplace_back(at + sf::Vector2f{0, cell}, colour, sf::Vector2f{0, 300});
+            }
+        }
+        for (std::size_t s = 0; s != splatCells.size(); ++s) {
+            const auto alpha = static_cast<std::uint8_t>(
+                std::min<std::size_t>(255, 63 + 48 * splatCounts[splatCells[s]]));
+            for (std::size_t v = 0; v != 4; ++v) splatVerts[s * 4 + v].color.a = alpha;
+        }
+        window.draw(splatVerts.data(), splatVerts.size(), sf::Quads, &pointTexture);
+    }
+
     // draws fps graph using fps ring buffer
     void fpsGraph() {
         ImPlot::PushStyleColor(ImPlotCol_FrameBg, {0, 0, 0, 0});
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "EntityManager.hpp"
+#include "Fundamentals/Vector2.hpp"
+#include "Islands.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+
+// Drags a point towards the cursor while the sim runs. The pull is a critically damped spring
+// scaled by the point's mass (so light and heavy points follow alike) towards the target and its
+// velocity, applied as an impulse before each step. Its rate is capped at half over the step,
+// where the discrete pull settles fastest without overshooting, so no setting can blow it up.
+class Grab {
+  private:
+    std::optional<PointId> point;
+    Vec2                   target;
+    Vec2                   targetVel;
+    double                 targetTime = 0.0; // wall time the target last moved
+
+  public:
+    static constexpr double stillAfter = 0.02; // s without moving before the cursor is at rest
+
+    double responseTime = 0.05; // s for the point to close most of the gap
+
+    std::optional<PointId> grabbed() const { return point; }
+    Vec2                   cursor() const { return target; }
+
+    void pick(PointId p, const Vec2& at, double time) {
+        point      = p;
+        target     = at;
+        targetVel  = Vec2{};
+        targetTime = time;
+    }
+
+    void release() { point.reset(); }
+
+    // new cursor position, sampled between steps. The cursor only moves at the mouse's own rate
+    // so its velocity is taken between moves, and is zero once it has stayed still a while.
+    void moveTo(const Vec2& at, double time) {
+        if (!point) return;
+        if (at.x != target.x || at.y != target.y) {
+            targetVel  = time > targetTime ? (at - target) / (time - targetTime) : Vec2{};
+            target     = at;
+            targetTime = time;
+        } else if (time - targetTime > stillAfter) {
+            targetVel = Vec2{};
+        }
+    }
+
+    // pulls the point for a step of h seconds, stepEvery is the step the integrator moves the
+    // point by (Solver::integrationStep)
+    void apply(EntityManager& entities, Islands& islands, double h, double stepEvery) {
+        if (!point || static_cast<std::size_t>(*point) >= entities.points.size()) return;
+        Point& p = entities.points[static_cast<std::size_t>(*point)];
+        if (p.fixed) return;
+        islands.wake(static_cast<std::size_t>(*point)); // keeps it awake while held
+        const double omega = std::min(1.0 / responseTime, 0.5 / std::max(h, stepEvery));
+        p.vel += ((target - p.pos) * (omega * omega) + (targetVel - p.vel) * (2.0 * omega)) * h;
+    }
+};
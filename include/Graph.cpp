@@ -6,7 +6,6 @@
 #include <optional>
 #include <string>
 
-// retrieve value from entities
 float Graph::getValue(const EntityManager& entities) {
     Vec2 value;
     Vec2 value2;
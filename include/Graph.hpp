@@ -1,10 +1,12 @@
 #pragma once
 
 #include "physics-envy/Engine.hpp"
-#include "physics-envy/fundamentals/RingBuffer.hpp"
+#include "FrameArena.hpp"
+#include "Renumber.hpp"
 #include "implot.h"
 #include <array>
 #include <cstddef>
+#include <optional>
 #include <string>
 #include <type_traits>
 
@@ -38,15 +40,30 @@ using GraphId = Index<Graph>;
 class Graph {
   private:
     union Inflex {
-        PointId     p;
-        SpringId    s;
+        PointId  p;
+        SpringId s;
+        Inflex(PointId p_) : p(p_) {}
+        Inflex(SpringId s_) : s(s_) {}
         std::size_t getUnderlying(ObjectType indexType) const {
             return indexType == ObjectType::Point ? static_cast<std::size_t>(p)
                                                   : static_cast<std::size_t>(s);
         }
     };
 
-    float getValue(const EntityManager& entities);
+    // what the label was made from
+    struct LabelKey {
+        ObjectType  type;
+        Property    prop;
+        Component   comp;
+        DiffState   diff;
+        std::size_t ref;
+        std::size_t ref2;
+
+        bool operator==(const LabelKey& other) const = default;
+    };
+
+    mutable std::optional<LabelKey> labelKey;
+    mutable std::string             yLabel;
 
     float getComponent(Vec2F value) {
         switch (comp) {
@@ -61,20 +78,20 @@ class Graph {
     }
 
   public:
-    RingBuffer<float> data;
-    Inflex            ref;
-    Inflex            ref2;
-    Vec2F             constDiff;
-    ObjectType        type;
-    Property          prop;
-    Component         comp = Component::vec;
-    DiffState         diff;
+    Inflex                     ref;
+    Inflex                     ref2;
+    Vec2F                      constDiff;
+    ObjectType                 type;
+    Property                   prop;
+    Component                  comp = Component::vec;
+    DiffState                  diff;
+    std::optional<std::size_t> column; // samples in the GraphManager's columns
 
     // three constructors for all diff types
     // no diff
     template <GraphableObj Type>
-    Graph(Index<Type> ref_, Property prop_, Component comp_, std::size_t buffer)
-        : data(buffer), ref(ref_), ref2(ref_), prop(prop_), comp(comp_), diff(DiffState::None) {
+    Graph(Index<Type> ref_, Property prop_, Component comp_)
+        : ref(ref_), ref2(ref_), prop(prop_), comp(comp_), diff(DiffState::None) {
         if constexpr (std::is_same_v<Type, Point>)
             type = ObjectType::Point;
         else
@@ -83,9 +100,9 @@ class Graph {
 
     // index diff
     template <GraphableObj Type>
-    Graph(Index<Type> ref_, Index<Type> ref2_, Property prop_, Component comp_, std::size_t buffer)
-        : data(buffer), ref(ref_), ref2(ref2_), prop(prop_), comp(comp_), diff(DiffState::Index) {
-        if constexpr (std::is_same_v<Type, PointId>)
+    Graph(Index<Type> ref_, Index<Type> ref2_, Property prop_, Component comp_)
+        : ref(ref_), ref2(ref2_), prop(prop_), comp(comp_), diff(DiffState::Index) {
+        if constexpr (std::is_same_v<Type, Point>)
             type = ObjectType::Point;
         else
             type = ObjectType::Spring;
@@ -93,8 +110,8 @@ class Graph {
 
     // const diff
     template <GraphableObj Type>
-    Graph(Index<Type> ref_, Vec2F constDiff_, Property prop_, Component comp_, std::size_t buffer)
-        : data(buffer), ref(ref_), ref2(ref_), constDiff(constDiff_), prop(prop_), comp(comp_),
+    Graph(Index<Type> ref_, Vec2F constDiff_, Property prop_, Component comp_)
+        : ref(ref_), ref2(ref_), constDiff(constDiff_), prop(prop_), comp(comp_),
           diff(DiffState::Const) {
         if constexpr (std::is_same_v<Type, Point>)
             type = ObjectType::Point;
@@ -114,6 +131,16 @@ class Graph {
         if (ref2.s == old) ref2.s = updated;
     }
 
+    void renumber(const Renumbering& renumbering) {
+        if (type == ObjectType::Point) {
+            ref.p  = renumbering(ref.p);
+            ref2.p = renumbering(ref2.p);
+        } else {
+            ref.s  = renumbering(ref.s);
+            ref2.s = renumbering(ref2.s);
+        }
+    }
+
     bool checkDeleteIndex(PointId id) {
         if (type != ObjectType::Point) return false;
         if (ref.p == id) return true;
@@ -128,25 +155,35 @@ class Graph {
         return false;
     }
 
-    void add(const EntityManager& entities) { data.add(getValue(entities)); }
+    // retrieve value from entities
+    float getValue(const EntityManager& entities);
 
-    void draw(GraphId i, const RingBuffer<float>& yvalues) {
-        if (ImPlot::BeginPlot(("Graph " + std::to_string(static_cast<std::size_t>(i))).c_str(), {-1, 0},
-                              ImPlotFlags_NoLegend | ImPlotFlags_NoTitle)) {
+    // plots count samples stride bytes apart of the time and value columns starting from offset
+    // (ring buffers)
+    void draw(GraphId i, const float* time, const float* values, int count, int offset,
+              int stride = sizeof(float)) const {
+        if (ImPlot::BeginPlot(frameArena.format("Graph %zu", static_cast<std::size_t>(i)),
+                              {-1, 0}, ImPlotFlags_NoLegend | ImPlotFlags_NoTitle)) {
             ImPlot::SetupAxis(ImAxis_X1, "Time", ImPlotAxisFlags_AutoFit);
             ImPlot::SetupAxis(ImAxis_Y1, getYLabel().c_str(), ImPlotAxisFlags_AutoFit);
             ImPlot::SetAxes(ImAxis_X1, ImAxis_Y1);
-            ImPlot::PlotLine("Line", &yvalues.v[0], &data.v[0], static_cast<int>(data.v.size()),
-                             ImPlotLineFlags_None, static_cast<int>(data.pos));
+            ImPlot::PlotLine("Line", time, values, count, ImPlotLineFlags_None, offset, stride);
             ImPlot::EndPlot();
         }
     }
 
-    std::string getYLabel() const {
-        return getTypeLbl(type) + "(" +
-               (diff == DiffState::Index ? std::to_string(ref.getUnderlying(type)) + "-" +
-                                               std::to_string(ref2.getUnderlying(type))
-                                         : std::to_string(ref.getUnderlying(type))) +
-               ")." + getPropLbl(prop) + "." + getCompLbl(comp);
+    // cached until the graph changes
+    const std::string& getYLabel() const {
+        const LabelKey key{type, prop, comp, diff, ref.getUnderlying(type),
+                           ref2.getUnderlying(type)};
+        if (labelKey != key) {
+            labelKey = key;
+            yLabel   = getTypeLbl(type) + "(" +
+                     (diff == DiffState::Index ? std::to_string(ref.getUnderlying(type)) + "-" +
+                                                     std::to_string(ref2.getUnderlying(type))
+                                               : std::to_string(ref.getUnderlying(type))) +
+                     ")." + getPropLbl(prop) + "." + getCompLbl(comp);
+        }
+        return yLabel;
     }
 };
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Column store for the graph samples, one ring buffer column per graph plus the shared time
+// column (column 0). Columns are allocated in pages of pageColumns contiguous columns, so a new
+// graph taking a column never moves the others and a removed graph's column is reused by the
+// next one. Nothing is reallocated between runs unless the length changes.
+class GraphColumns {
+  private:
+    std::vector<std::vector<float>> pages;
+    std::vector<std::size_t>        freeColumns;
+    std::vector<bool>               taken;
+    std::size_t                     length;
+    std::size_t                     pos    = 0; // next row to write
+    std::size_t                     filled = 0;
+    std::size_t                     row    = 0; // row being written
+
+  public:
+    static constexpr std::size_t pageColumns = 16;
+    static constexpr std::size_t timeColumn  = 0;
+
+    explicit GraphColumns(std::size_t length_) : length(length_) { acquire(); }
+
+    // empties every column, only reallocating if the length changed
+    void reset(std::size_t length_) {
+        if (length_ != length) {
+            length = length_;
+            for (std::vector<float>& page: pages) page.assign(pageColumns * length, 0.0F);
+        }
+        pos    = 0;
+        filled = 0;
+    }
+
+    // a zeroed column
+    std::size_t acquire() {
+        std::size_t c;
+        if (!freeColumns.empty()) {
+            c = freeColumns.back();
+            freeColumns.pop_back();
+        } else {
+            c = taken.size();
+            taken.push_back(false);
+            if (c / pageColumns == pages.size()) pages.emplace_back(pageColumns * length, 0.0F);
+        }
+        taken[c] = true;
+        std::fill_n(column(c), length, 0.0F);
+        return c;
+    }
+
+    void release(std::size_t c) {
+        taken[c] = false;
+        freeColumns.push_back(c);
+    }
+
+    // starts a new row at time t, the graphs then fill it with set
+    void push(float t) {
+        row                     = pos;
+        column(timeColumn)[row] = t;
+        if (++pos == length) pos = 0;
+        filled = std::min(filled + 1, length);
+    }
+
+    void set(std::size_t c, float value) { column(c)[row] = value; }
+
+    float* column(std::size_t c) {
+        return pages[c / pageColumns].data() + (c % pageColumns) * length;
+    }
+    const float* column(std::size_t c) const {
+        return pages[c / pageColumns].data() + (c % pageColumns) * length;
+    }
+
+    // value of the last row (0 before the first)
+    float latest(std::size_t c) const { return filled == 0 ? 0.0F : column(c)[row]; }
+
+    bool        isTaken(std::size_t c) const { return taken[c]; }
+    std::size_t columns() const { return taken.size(); }
+    std::size_t rows() const { return filled; }
+    std::size_t size() const { return length; }
+    std::size_t first() const { return filled == length ? pos : 0; } // oldest row
+};
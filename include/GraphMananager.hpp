@@ -1,76 +1,183 @@
 #pragma once
 
+#include "ConservationMonitor.hpp"
 #include "EntityManager.hpp"
 #include "Graph.hpp"
+#include "GraphColumns.hpp"
+#include "Timestamp.hpp"
+#include "Trace.hpp"
+#include <array>
 #include <cstddef>
 #include <ctime>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <optional>
+#include <string_view>
+#include <vector>
 
 class GraphManager {
   private:
-    EntityManager& entities;
+    EntityManager&    entities;
+    GraphColumns      columns;
+    std::vector<bool> seen; // assignColumns scratch
+
+    // columns of the built in channels, only taken while the monitor is enabled
+    std::array<std::optional<std::size_t>, ChannelLbl.size()> channelColumns;
+
+    // samples to plot, strides which don't divide the buffer would break the wrap around so
+    // those plot it all
+    struct PlotWindow {
+        int count;
+        int offset;
+        int stride; // bytes
+    };
+    PlotWindow plotWindow() const {
+        const std::size_t k      = columns.size() % stride == 0 ? stride : 1;
+        const std::size_t count  = (columns.rows() + k - 1) / k;
+        const std::size_t offset = columns.rows() == columns.size()
+                                       ? (columns.first() + k - 1) / k % count
+                                       : 0;
+        return {static_cast<int>(count), static_cast<int>(offset),
+                static_cast<int>(k * sizeof(float))};
+    }
+
+    void plotChannel(Channel c, const PlotWindow& w) const {
+        ImPlot::PlotLine(ChannelLbl[static_cast<std::size_t>(c)],
+                         columns.column(GraphColumns::timeColumn),
+                         columns.column(*channelColumns[static_cast<std::size_t>(c)]), w.count,
+                         ImPlotLineFlags_None, w.offset, w.stride);
+    }
 
   public:
-    RingBuffer<float> tValues;
-    bool              hasDumped = false;
-    std::size_t       graphBuffer;
+    bool                hasDumped = false;
+    std::size_t         graphBuffer;
+    std::size_t         stride = 1; // plot every k-th sample (lowered detail)
+    ConservationMonitor monitor;
 
     GraphManager(EntityManager& entities_, std::size_t graphBuffer_ = 5000)
-        : entities(entities_), tValues(graphBuffer_), graphBuffer(graphBuffer_) {
+        : entities(entities_), columns(graphBuffer_), graphBuffer(graphBuffer_) {
         std::filesystem::create_directory("graphdata");
     }
 
+    // gives new (or copied) graphs a column and frees the columns of removed ones
+    void assignColumns() {
+        seen.assign(columns.columns(), false);
+        seen[GraphColumns::timeColumn] = true;
+        for (std::optional<std::size_t>& c: channelColumns) {
+            if (!monitor.enabled) {
+                c.reset(); // released below
+                continue;
+            }
+            if (!c) {
+                c = columns.acquire();
+                seen.resize(columns.columns(), false);
+            }
+            seen[*c] = true;
+        }
+        for (Graph& g: entities.graphs) {
+            if (!g.column || *g.column >= seen.size() || seen[*g.column]) {
+                g.column = columns.acquire();
+                seen.resize(columns.columns(), false);
+            }
+            seen[*g.column] = true;
+        }
+        for (std::size_t c = 0; c != seen.size(); ++c) {
+            if (!seen[c] && columns.isTaken(c)) columns.release(c);
+        }
+    }
+
+    // takes a sample of every graph and enabled built in channel
+    void sample(float t, double gravity) {
+        assignColumns();
+        columns.push(t);
+        if (monitor.enabled) {
+            monitor.sample(entities, gravity);
+            for (std::size_t c = 0; c != channelColumns.size(); ++c)
+                columns.set(*channelColumns[c],
+                            static_cast<float>(monitor.latest[static_cast<Channel>(c)]));
+        }
+        for (Graph& g: entities.graphs) columns.set(*g.column, g.getValue(entities));
+    }
+
     // update values and draw
-    void updateDraw(float t) {
+    void updateDraw(float t, double gravity) {
         ImGui::Begin("Graphs");
-        tValues.add(t);
-        for (GraphId i{}; i != static_cast<GraphId>(entities.graphs.size()); ++i) {
-            entities.graphs[static_cast<std::size_t>(i)].add(entities);
-            entities.graphs[static_cast<std::size_t>(i)].draw(i, tValues);
-        }
+        sample(t, gravity);
+        drawChannels();
+        for (GraphId i{}; i != static_cast<GraphId>(entities.graphs.size()); ++i) draw(i);
         ImGui::End();
     }
 
-    void reset() {
-        tValues = RingBuffer<float>(graphBuffer);
-        for (Graph& g: entities.graphs) {
-            g.data = RingBuffer<float>(graphBuffer);
+    // plots a graph straight from its column (assignColumns must have been called since it was
+    // added)
+    void draw(GraphId i) const {
+        const Graph&     g = entities.graphs[static_cast<std::size_t>(i)];
+        const PlotWindow w = plotWindow();
+        g.draw(i, columns.column(GraphColumns::timeColumn), columns.column(*g.column), w.count,
+               w.offset, w.stride);
+    }
+
+    // energy and momentum plots with the drift alarms (assignColumns must have been called since
+    // the monitor was enabled)
+    void drawChannels() const {
+        if (!monitor.enabled) return;
+        if (monitor.energyAlarm)
+            ImGui::TextColored(ImVec4{1, 0, 0, 1}, "Energy drift %.2f%%",
+                               100.0 * monitor.energyDrift());
+        if (monitor.momentumAlarm)
+            ImGui::TextColored(ImVec4{1, 0, 0, 1}, "Momentum drift %.2f%%",
+                               100.0 * monitor.momentumDrift());
+        const PlotWindow w = plotWindow();
+        if (ImPlot::BeginPlot("Energy", {-1, 0}, ImPlotFlags_NoTitle)) {
+            ImPlot::SetupAxis(ImAxis_X1, "Time", ImPlotAxisFlags_AutoFit);
+            ImPlot::SetupAxis(ImAxis_Y1, "Energy", ImPlotAxisFlags_AutoFit);
+            for (Channel c: {Channel::Kinetic, Channel::Spring, Channel::Gravity, Channel::Total})
+                plotChannel(c, w);
+            ImPlot::EndPlot();
         }
+        if (ImPlot::BeginPlot("Momentum", {-1, 0}, ImPlotFlags_NoTitle)) {
+            ImPlot::SetupAxis(ImAxis_X1, "Time", ImPlotAxisFlags_AutoFit);
+            ImPlot::SetupAxis(ImAxis_Y1, "Momentum", ImPlotAxisFlags_AutoFit);
+            for (Channel c: {Channel::MomentumX, Channel::MomentumY}) plotChannel(c, w);
+            ImPlot::EndPlot();
+        }
+    }
+
+    // calls fn(label, value) with the latest sample of every graph and enabled built in channel
+    template <typename F>
+    void forLatest(F&& fn) const {
+        for (const Graph& g: entities.graphs) {
+            if (g.column) fn(std::string_view{g.getYLabel()}, columns.latest(*g.column));
+        }
+        for (std::size_t c = 0; c != channelColumns.size(); ++c) {
+            if (channelColumns[c])
+                fn(std::string_view{ChannelLbl[c]}, columns.latest(*channelColumns[c]));
+        }
+    }
+
+    // nothing to graph or dump
+    bool empty() const { return entities.graphs.empty() && !monitor.enabled; }
+
+    // clears the samples and takes the monitor's starting values, call at the start of a run
+    void reset(double gravity) {
+        columns.reset(graphBuffer);
         hasDumped = false;
+        monitor.start(entities, gravity);
     }
 
     // dump graph data to file
     void dumpData() {
+        TraceSpan span("graph dump");
         hasDumped = true;
-        if (entities.graphs.empty()) throw std::runtime_error("Graphs are empty cannot dump data");
-
-        // check for valid graphs
-        std::vector<std::size_t> validGraphs;
-        for (std::size_t i = 0; i != entities.graphs.size(); ++i) {
-            if (!entities.graphs[i].data.v.empty()) {
-                validGraphs.push_back(i); // add valid graphs to "goodens" list
-            }
-        }
-        if (validGraphs.empty()) {
+        if (empty()) throw std::runtime_error("Graphs are empty cannot dump data");
+        assignColumns();
+        if (columns.rows() == 0) {
             std::cout << "No data to plot nothing saved \n";
             return;
         }
 
-        // get time and date
-        const std::chrono::time_point     now{std::chrono::system_clock::now()};
-        const std::chrono::year_month_day ymd{std::chrono::floor<std::chrono::days>(now)};
-        const std::chrono::hh_mm_ss       hms{now - std::chrono::floor<std::chrono::days>(now)};
-        std::string name = std::to_string(static_cast<int>(ymd.year())) + "-" +
-                           std::to_string(static_cast<unsigned>(ymd.month())) + "-" +
-                           std::to_string(static_cast<unsigned>(ymd.day())) + "_" +
-                           std::to_string(static_cast<unsigned>(hms.hours().count())) + "." +
-                           std::to_string(static_cast<unsigned>(hms.minutes().count())) + "." +
-                           std::to_string(static_cast<unsigned>(hms.seconds().count()));
-        name.pop_back();
-        std::replace(name.begin(), name.end(), ' ', '-');
-        std::filesystem::path path = "graphdata/" + name + ".csv";
+        std::filesystem::path path = "graphdata/" + timestamp() + ".csv";
         path.make_preferred();
         std::cout << "Storing graph data at: " << path << "\n";
         std::ofstream file{path, std::ios_base::out};
@@ -81,21 +188,26 @@ class GraphManager {
         file << std::fixed << std::setprecision(std::numeric_limits<float>::max_digits10);
         // headers
         file << "Time";
-        for (const std::size_t valid: validGraphs) {
-            file << "," << entities.graphs[valid].getYLabel();
+        std::vector<const float*> data; // columns in output order
+        if (monitor.enabled) {
+            for (std::size_t c = 0; c != channelColumns.size(); ++c) {
+                file << "," << ChannelLbl[c];
+                data.push_back(columns.column(*channelColumns[c]));
+            }
+        }
+        for (const Graph& g: entities.graphs) {
+            file << "," << g.getYLabel();
+            data.push_back(columns.column(*g.column));
         }
         file << "\n";
 
-        // data
-        std::size_t current = tValues.pos;
-        do {
-            file << tValues.v[current];
-            for (const std::size_t valid: validGraphs) {
-                file << "," << entities.graphs[valid].data.v[current];
-            }
+        // data, oldest row first
+        const float* time = columns.column(GraphColumns::timeColumn);
+        for (std::size_t row = 0, current = columns.first(); row != columns.rows(); ++row) {
+            file << time[current];
+            for (const float* column: data) file << "," << column[current];
             file << "\n";
-            ++current;
-            if (current == tValues.size) current = 0; // handle wrap around
-        } while (current != tValues.pos);
+            if (++current == columns.size()) current = 0; // handle wrap around
+        }
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,169 @@
+#include "History.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace {
+std::uint32_t quantize(double value) {
+    return std::bit_cast<std::uint32_t>(static_cast<float>(value));
+}
+
+double unquantize(std::uint32_t bits) { return static_cast<double>(std::bit_cast<float>(bits)); }
+
+// number of low bytes needed to hold x
+std::uint8_t significantBytes(std::uint32_t x) {
+    return static_cast<std::uint8_t>((32 - std::countl_zero(x) + 7) / 8);
+}
+} // namespace
+
+std::size_t History::Chunk::bytes() const {
+    return (key.size() + times.size()) * sizeof(double) + offsets.size() * sizeof(std::size_t) +
+           deltas.size();
+}
+
+// frames per chunk, fewer than keyframeInterval when a chunk of worst case deltas (every byte
+// changed) would be over the budget
+std::size_t History::chunkFrames() const {
+    const std::size_t keyBytes   = pointCount * 4 * sizeof(double) + sizeof(double);
+    const std::size_t deltaBytes = pointCount * 2 * (1 + 2 * sizeof(std::uint32_t)) +
+                                   sizeof(double) + sizeof(std::size_t);
+    if (keyBytes >= budget) return 1;
+    return std::clamp((budget - keyBytes) / deltaBytes + 1, std::size_t{1}, keyframeInterval);
+}
+
+void History::record(double time, const EntityManager& entities) {
+    TraceSpan span("history record");
+    if (entities.points.size() != pointCount) {
+        clear();
+        pointCount = entities.points.size();
+    }
+    const std::size_t valueCount = pointCount * 4;
+    lastBits.resize(valueCount);
+    current.clear();
+    for (const Point& p: entities.points) {
+        current.insert(current.end(), {p.pos.x, p.pos.y, p.vel.x, p.vel.y});
+    }
+
+    if (chunks.empty() || chunks.back().times.size() >= chunkFrames()) {
+        Chunk& chunk = chunks.emplace_back(std::move(spare));
+        spare        = Chunk{};
+        chunk.times.clear();
+        chunk.offsets.clear();
+        chunk.deltas.clear();
+        chunk.key = current;
+        for (std::size_t i = 0; i != valueCount; ++i) lastBits[i] = quantize(current[i]);
+        chunk.times.push_back(time);
+        usedBytes += chunk.bytes();
+    } else {
+        Chunk&            chunk  = chunks.back();
+        const std::size_t before = chunk.bytes();
+        chunk.offsets.push_back(chunk.deltas.size());
+        chunk.times.push_back(time);
+
+        // pairs of values share a header byte holding both byte counts, then the bytes
+        std::array<std::uint32_t, 2> x{};
+        for (std::size_t i = 0; i != valueCount; i += 2) {
+            for (std::size_t j = 0; j != 2; ++j) {
+                const std::uint32_t bits = quantize(current[i + j]);
+                x[j]                     = bits ^ lastBits[i + j];
+                lastBits[i + j]          = bits;
+            }
+            const std::uint8_t n0 = significantBytes(x[0]);
+            const std::uint8_t n1 = significantBytes(x[1]);
+            chunk.deltas.push_back(static_cast<std::uint8_t>(n0 | n1 << 4));
+            for (std::uint8_t b = 0; b != n0; ++b)
+                chunk.deltas.push_back(static_cast<std::uint8_t>(x[0] >> (b * 8)));
+            for (std::uint8_t b = 0; b != n1; ++b)
+                chunk.deltas.push_back(static_cast<std::uint8_t>(x[1] >> (b * 8)));
+        }
+        usedBytes += chunk.bytes() - before;
+    }
+    ++frameCount;
+    position = frameCount - 1;
+
+    // drop the oldest chunks (never the one being written), the spare is held memory too
+    while (usedBytes + spare.bytes() > budget && chunks.size() > 1) {
+        usedBytes -= chunks.front().bytes();
+        frameCount -= chunks.front().times.size();
+        position -= chunks.front().times.size();
+        spare = std::move(chunks.front());
+        chunks.pop_front();
+    }
+    if (usedBytes + spare.bytes() > budget) spare = Chunk{};
+}
+
+// reconstructs a frame from its chunk's keyframe and the deltas up to it
+void History::decode(std::size_t frame, std::vector<double>& values) const {
+    std::size_t c = 0;
+    while (frame >= chunks[c].times.size()) frame -= chunks[c++].times.size();
+    const Chunk& chunk = chunks[c];
+    values             = chunk.key;
+    if (frame == 0) return; // keyframes are exact
+
+    std::vector<std::uint32_t> bits(values.size());
+    for (std::size_t i = 0; i != values.size(); ++i) bits[i] = quantize(values[i]);
+    std::size_t at = 0;
+    for (std::size_t f = 1; f <= frame; ++f) {
+        for (std::size_t i = 0; i != values.size(); i += 2) {
+            const std::uint8_t header = chunk.deltas[at++];
+            for (std::size_t j = 0; j != 2; ++j) {
+                const std::uint8_t n = j == 0 ? header & 0xF : header >> 4;
+                std::uint32_t      x = 0;
+                for (std::uint8_t b = 0; b != n; ++b)
+                    x |= static_cast<std::uint32_t>(chunk.deltas[at++]) << (b * 8);
+                bits[i + j] ^= x;
+            }
+        }
+    }
+    for (std::size_t i = 0; i != values.size(); ++i) values[i] = unquantize(bits[i]);
+}
+
+void History::restore(std::size_t frame, EntityManager& entities) {
+    if (frame >= frameCount || entities.points.size() != pointCount) return;
+    TraceSpan           span("history restore");
+    std::vector<double> values;
+    decode(frame, values);
+    for (std::size_t i = 0; i != pointCount; ++i) {
+        entities.points[i].pos = {values[i * 4], values[i * 4 + 1]};
+        entities.points[i].vel = {values[i * 4 + 2], values[i * 4 + 3]};
+    }
+    position = frame;
+}
+
+void History::truncate() {
+    if (frameCount == 0 || position + 1 == frameCount) return;
+    std::vector<double> values;
+    decode(position, values);
+    for (std::size_t i = 0; i != values.size(); ++i) lastBits[i] = quantize(values[i]);
+
+    std::size_t keep = position + 1; // frames kept
+    std::size_t c    = 0;
+    while (keep > chunks[c].times.size()) keep -= chunks[c++].times.size();
+    while (chunks.size() > c + 1) {
+        usedBytes -= chunks.back().bytes();
+        chunks.pop_back();
+    }
+    Chunk& chunk = chunks.back();
+    usedBytes -= chunk.bytes();
+    if (keep < chunk.times.size()) chunk.deltas.resize(chunk.offsets[keep - 1]);
+    chunk.times.resize(keep);
+    chunk.offsets.resize(keep - 1);
+    usedBytes += chunk.bytes();
+    frameCount = position + 1;
+}
+
+void History::clear() {
+    chunks.clear();
+    lastBits.clear();
+    pointCount = 0;
+    frameCount = 0;
+    usedBytes  = 0;
+    position   = 0;
+}
+
+double History::time(std::size_t frame) const {
+    std::size_t c = 0;
+    while (frame >= chunks[c].times.size()) frame -= chunks[c++].times.size();
+    return chunks[c].times[frame];
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "EntityManager.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// In memory recording of the point positions and velocities of a run (one frame per visual
+// frame) which can be scrubbed back to and resumed from. Every keyframeInterval frames a full
+// keyframe is kept, the frames in between are quantized to float and stored as the XOR with the
+// previous frame with leading zero bytes dropped. Whole chunks (keyframe + deltas) are dropped
+// from the front to stay inside the memory budget, chunks get fewer frames when a whole one
+// wouldn't fit in it (at least the frame being written is always kept).
+class History {
+  private:
+    struct Chunk {
+        std::vector<double>       key;     // pos.x, pos.y, vel.x, vel.y per point
+        std::vector<double>       times;   // sim time of each frame
+        std::vector<std::size_t>  offsets; // start of each frame's delta in deltas (frame 1+)
+        std::vector<std::uint8_t> deltas;
+
+        std::size_t bytes() const;
+    };
+
+    std::deque<Chunk>          chunks;
+    Chunk                      spare;    // last dropped chunk, reused to save allocating
+    std::vector<std::uint32_t> lastBits; // quantized values of the last recorded frame
+    std::vector<double>        current;  // values being recorded (kept to avoid reallocating)
+    std::size_t                pointCount = 0;
+    std::size_t                frameCount = 0;
+    std::size_t                usedBytes  = 0;
+
+    void decode(std::size_t frame, std::vector<double>& values) const;
+    std::size_t chunkFrames() const;
+
+  public:
+    std::size_t keyframeInterval = 100;          // at most, see chunkFrames
+    std::size_t budget           = 256ULL << 20; // bytes, including the spare chunk
+    std::size_t position         = 0;            // frame last recorded or restored
+
+    // appends the current state, clears the history first if the points changed
+    void record(double time, const EntityManager& entities);
+
+    // writes frame back into the points and makes it the current position
+    void restore(std::size_t frame, EntityManager& entities);
+
+    // forgets the frames after the current position (called when resuming from a scrub)
+    void truncate();
+
+    void clear();
+
+    std::size_t frames() const { return frameCount; }
+    std::size_t bytes() const { return usedBytes; }
+    double      time(std::size_t frame) const;
+};
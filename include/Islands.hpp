@@ -0,0 +1,280 @@
+#pragma once
+
+#include "EntityManager.hpp"
+#include "Fundamentals/Vector2.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <vector>
+
+// Connected groups of points (joined by springs, fixed points don't join anything) which can be
+// put to sleep once they come to rest. The integrators in Solver only loop over activePoints and
+// activeSprings so resting bodies cost nothing until something wakes them (except under the
+// engine's explicit step, which moves every point and has the sleeping ones put back).
+class Islands {
+  public:
+    static constexpr std::size_t none = std::numeric_limits<std::size_t>::max();
+
+  private:
+    struct Island {
+        std::size_t pointsBegin;
+        std::size_t pointsEnd;
+        std::size_t springsBegin;
+        std::size_t springsEnd;
+        double      idleTime = 0.0; // time spent below sleepEnergy
+        bool        awake    = true;
+        Vec2        min;            // bounds, for waking on contact
+        Vec2        max;
+    };
+
+    std::vector<Island>      islands;
+    std::vector<std::size_t> pointIsland;   // island of each point (none for fixed)
+    std::vector<std::size_t> islandPoints;  // points grouped by island
+    std::vector<std::size_t> islandSprings; // springs grouped by island
+    std::size_t              springCount = 0; // when last rebuilt
+    bool                     dirty       = true;
+    std::size_t              changes     = 0; // bumped whenever the active set changes
+
+    // bounds of an island for the wake check's sort and sweep (awake ones grown by the margin)
+    struct SweepBox {
+        Vec2        min;
+        Vec2        max;
+        std::size_t island;
+        bool        awake; // when the sweep started
+    };
+    std::vector<SweepBox> sweepBoxes;          // kept in last step's order
+    bool                  sweepSorted = false; // whether that order is still close
+    std::vector<SweepBox> openAwake; // boxes the sweep is still inside
+    std::vector<SweepBox> openAsleep;
+
+    static std::size_t find(std::vector<std::size_t>& parent, std::size_t i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]]; // path halving
+            i         = parent[i];
+        }
+        return i;
+    }
+
+    void updateBounds(const EntityManager& entities, Island& island) const {
+        island.min = Vec2{std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+        island.max = island.min * -1.0;
+        for (std::size_t i = island.pointsBegin; i != island.pointsEnd; ++i) {
+            const Vec2& pos = entities.points[islandPoints[i]].pos;
+            island.min      = {std::min(island.min.x, pos.x), std::min(island.min.y, pos.y)};
+            island.max      = {std::max(island.max.x, pos.x), std::max(island.max.y, pos.y)};
+        }
+    }
+
+    // rebuilds the active ranges from the awake islands (keeps island order so the integration
+    // order is the same every run)
+    void rebuildActive() {
+        ++changes;
+        activePoints.clear();
+        activeSprings.clear();
+        for (const Island& island: islands) {
+            if (!island.awake) continue;
+            activePoints.insert(activePoints.end(),
+                                islandPoints.begin() + static_cast<long>(island.pointsBegin),
+                                islandPoints.begin() + static_cast<long>(island.pointsEnd));
+            activeSprings.insert(activeSprings.end(),
+                                 islandSprings.begin() + static_cast<long>(island.springsBegin),
+                                 islandSprings.begin() + static_cast<long>(island.springsEnd));
+        }
+    }
+
+    // islands barely move in a step so last step's order is nearly sorted, insertion sort is
+    // close to linear on it
+    void sortSweep() {
+        const auto lower = [](const SweepBox& a, const SweepBox& b) { return a.min.x < b.min.x; };
+        if (!sweepSorted) {
+            std::sort(sweepBoxes.begin(), sweepBoxes.end(), lower);
+            sweepSorted = true;
+            return;
+        }
+        for (std::size_t i = 1; i < sweepBoxes.size(); ++i) {
+            for (std::size_t j = i; j != 0 && lower(sweepBoxes[j], sweepBoxes[j - 1]); --j)
+                std::swap(sweepBoxes[j], sweepBoxes[j - 1]);
+        }
+    }
+
+  public:
+    std::vector<std::size_t> activePoints;  // awake, non fixed points
+    std::vector<std::size_t> activeSprings; // springs of awake islands
+
+    bool   sleeping    = false; // whether resting islands are put to sleep
+    double sleepEnergy = 1e-4;  // kinetic energy per unit mass (J/kg) below which an island idles
+    double sleepTime   = 0.5;   // seconds idle before sleeping
+    double wakeMargin  = 0.1;   // distance at which an awake island wakes a sleeping one
+
+    // recomputes the islands from the spring graph, everything starts awake
+    void rebuild(const EntityManager& entities) {
+        const std::size_t        n = entities.points.size();
+        std::vector<std::size_t> parent(n);
+        std::iota(parent.begin(), parent.end(), 0);
+        for (const Spring& s: entities.springs) {
+            const std::size_t p1 = static_cast<std::size_t>(s.p1);
+            const std::size_t p2 = static_cast<std::size_t>(s.p2);
+            if (entities.points[p1].fixed || entities.points[p2].fixed) continue;
+            parent[find(parent, p1)] = find(parent, p2);
+        }
+
+        // number the roots in point order and group (counting sort) points and springs
+        islands.clear();
+        pointIsland.assign(n, none);
+        std::vector<std::size_t> rootIsland(n, none);
+        for (std::size_t i = 0; i != n; ++i) {
+            if (entities.points[i].fixed) continue;
+            std::size_t& island = rootIsland[find(parent, i)];
+            if (island == none) {
+                island = islands.size();
+                islands.push_back({});
+            }
+            pointIsland[i] = island;
+        }
+        std::vector<std::size_t> pointCounts(islands.size() + 1, 0);
+        std::vector<std::size_t> springCounts(islands.size() + 1, 0);
+        for (std::size_t i = 0; i != n; ++i) {
+            if (pointIsland[i] != none) ++pointCounts[pointIsland[i] + 1];
+        }
+        for (const Spring& s: entities.springs) {
+            if (islandOf(s) != none) ++springCounts[islandOf(s) + 1];
+        }
+        std::partial_sum(pointCounts.begin(), pointCounts.end(), pointCounts.begin());
+        std::partial_sum(springCounts.begin(), springCounts.end(), springCounts.begin());
+        for (std::size_t i = 0; i != islands.size(); ++i) {
+            islands[i].pointsBegin  = pointCounts[i];
+            islands[i].pointsEnd    = pointCounts[i + 1];
+            islands[i].springsBegin = springCounts[i];
+            islands[i].springsEnd   = springCounts[i + 1];
+        }
+        islandPoints.resize(pointCounts.back());
+        islandSprings.resize(springCounts.back());
+        for (std::size_t i = 0; i != n; ++i) {
+            if (pointIsland[i] != none) islandPoints[pointCounts[pointIsland[i]]++] = i;
+        }
+        for (std::size_t i = 0; i != entities.springs.size(); ++i) {
+            const std::size_t island = islandOf(entities.springs[i]);
+            if (island != none) islandSprings[springCounts[island]++] = i;
+        }
+        sweepBoxes.clear(); // island numbers changed
+        rebuildActive();
+        springCount = entities.springs.size();
+        dirty       = false;
+    }
+
+    // the spring graph or fixed points changed, rebuild before the next update
+    void invalidate() { dirty = true; }
+
+    // rebuilds if invalidated (or points or springs were added/removed), called before stepping
+    void refresh(const EntityManager& entities) {
+        if (dirty || pointIsland.size() != entities.points.size() ||
+            springCount != entities.springs.size())
+            rebuild(entities);
+    }
+
+    // called after every integration step of h seconds
+    void update(EntityManager& entities, double h) {
+        refresh(entities);
+        if (!sleeping) return;
+        bool changed = false;
+        for (Island& island: islands) {
+            if (!island.awake) continue;
+            double energy = 0.0;
+            double mass   = 0.0;
+            for (std::size_t i = island.pointsBegin; i != island.pointsEnd; ++i) {
+                const Point& p = entities.points[islandPoints[i]];
+                energy += 0.5 * p.mass * p.vel.dot(p.vel);
+                mass += p.mass;
+            }
+            island.idleTime = energy < sleepEnergy * mass ? island.idleTime + h : 0.0;
+            if (island.idleTime < sleepTime) continue;
+            island.awake = false;
+            changed      = true;
+            updateBounds(entities, island);
+            for (std::size_t i = island.pointsBegin; i != island.pointsEnd; ++i) {
+                entities.points[islandPoints[i]].vel = Vec2{};
+            }
+        }
+
+        // awake islands touching sleeping ones wake them. Sort and sweep along x so only islands
+        // whose x ranges (the awake ones grown by the margin) overlap are compared.
+        const bool anyAsleep =
+            std::any_of(islands.begin(), islands.end(), [](const Island& i) { return !i.awake; });
+        if (!anyAsleep) {
+            sweepSorted = false; // the order goes stale while nothing is checked
+        } else {
+            if (sweepBoxes.size() != islands.size()) {
+                sweepBoxes.resize(islands.size());
+                for (std::size_t i = 0; i != islands.size(); ++i) sweepBoxes[i].island = i;
+                sweepSorted = false;
+            }
+            for (SweepBox& box: sweepBoxes) {
+                Island& island = islands[box.island];
+                if (island.awake) updateBounds(entities, island);
+                const Vec2 margin = island.awake ? Vec2{wakeMargin, wakeMargin} : Vec2{};
+                box               = {island.min - margin, island.max + margin, box.island,
+                                     island.awake};
+            }
+            sortSweep();
+            openAwake.clear();
+            openAsleep.clear();
+            for (const SweepBox& box: sweepBoxes) {
+                const auto ended = [&](const SweepBox& open) { return open.max.x < box.min.x; };
+                std::erase_if(openAwake, ended);
+                std::erase_if(openAsleep, ended);
+                for (const SweepBox& open: box.awake ? openAsleep : openAwake) {
+                    if (open.min.y > box.max.y || open.max.y < box.min.y) continue;
+                    Island& asleep = islands[box.awake ? open.island : box.island];
+                    if (asleep.awake) continue; // woken earlier in the sweep
+                    asleep.awake    = true;
+                    asleep.idleTime = 0.0;
+                    changed         = true;
+                }
+                (box.awake ? openAwake : openAsleep).push_back(box);
+            }
+        }
+        if (changed) rebuildActive();
+    }
+
+    // wakes the island containing point (eg when something pushes it)
+    void wake(std::size_t point) {
+        if (point >= pointIsland.size() || pointIsland[point] == none) return;
+        Island& island  = islands[pointIsland[point]];
+        island.idleTime = 0.0;
+        if (island.awake) return;
+        island.awake = true;
+        rebuildActive();
+    }
+
+    void wakeAll() {
+        for (Island& island: islands) {
+            island.awake    = true;
+            island.idleTime = 0.0;
+        }
+        rebuildActive();
+    }
+
+    std::size_t version() const { return changes; }
+    std::size_t count() const { return islands.size(); }
+    bool        isAwake(std::size_t island) const { return islands[island].awake; }
+
+    // island of a point, none for fixed points
+    std::size_t islandOf(std::size_t point) const { return pointIsland[point]; }
+
+    // island of a spring, none if both ends are fixed
+    std::size_t islandOf(const Spring& s) const {
+        const std::size_t i1 = pointIsland[static_cast<std::size_t>(s.p1)];
+        return i1 != none ? i1 : pointIsland[static_cast<std::size_t>(s.p2)];
+    }
+
+    std::span<const std::size_t> points(std::size_t island) const {
+        return {islandPoints.data() + islands[island].pointsBegin,
+                islandPoints.data() + islands[island].pointsEnd};
+    }
+    std::size_t asleep() const {
+        return static_cast<std::size_t>(std::count_if(
+            islands.begin(), islands.end(), [](const Island& i) { return !i.awake; }));
+    }
+};
@@ -0,0 +1,146 @@
+#include "PointCollider.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+void PointCollider::build(const EntityManager& entities, const Islands& islands) {
+    const std::vector<Point>& points = entities.points;
+    const std::size_t         n      = points.size();
+
+    // bounds and the biggest disc (non finite points are left out of the grid)
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    Vec2             min{inf, inf};
+    Vec2             max{-inf, -inf};
+    double           maxRadius = 0.0;
+    for (const Point& p: points) {
+        if (!std::isfinite(p.pos.x) || !std::isfinite(p.pos.y)) continue;
+        min       = {std::min(min.x, p.pos.x), std::min(min.y, p.pos.y)};
+        max       = {std::max(max.x, p.pos.x), std::max(max.y, p.pos.y)};
+        maxRadius = std::max(maxRadius, radiusOf(p));
+    }
+    if (min.x > max.x || maxRadius == 0.0) { // nothing can touch
+        columns = 0;
+        rows    = 0;
+        cellStarts.assign(1, 0);
+        order.clear();
+        return;
+    }
+
+    // cells at least as wide as the biggest pair of discs so only neighbouring cells can touch,
+    // grown if a spread out scene would need far more cells than points
+    origin                 = min;
+    cellSize               = 2 * maxRadius;
+    const double width     = (max.x - min.x) / cellSize + 1;
+    const double height    = (max.y - min.y) / cellSize + 1;
+    const double cellLimit = 4.0 * static_cast<double>(n) + 16.0;
+    if (width * height > cellLimit) cellSize *= std::sqrt(width * height / cellLimit);
+    columns = static_cast<std::size_t>((max.x - min.x) / cellSize) + 1;
+    rows    = static_cast<std::size_t>((max.y - min.y) / cellSize) + 1;
+
+    // counting sort by cell, the extra last cell holds the non finite points
+    const std::size_t outside = columns * rows;
+    cellStarts.assign(outside + 2, 0);
+    pointCells.resize(n);
+    for (std::size_t i = 0; i != n; ++i) {
+        const Vec2& p = points[i].pos;
+        pointCells[i] = !std::isfinite(p.x) || !std::isfinite(p.y)
+                            ? outside
+                            : static_cast<std::size_t>((p.y - min.y) / cellSize) * columns +
+                                  static_cast<std::size_t>((p.x - min.x) / cellSize);
+        ++cellStarts[pointCells[i] + 1];
+    }
+    std::partial_sum(cellStarts.begin(), cellStarts.end(), cellStarts.begin());
+
+    order.resize(n);
+    cells.resize(n);
+    pos.resize(n);
+    vel.resize(n);
+    radii.resize(n);
+    invMass.resize(n);
+    island.resize(n);
+    touching.resize(n);
+    for (std::size_t i = 0; i != n; ++i) {
+        const std::size_t k = cellStarts[pointCells[i]]++;
+        const Point&      p = points[i];
+        const std::size_t b = islands.islandOf(i);
+        order[k]            = i;
+        cells[k]            = pointCells[i];
+        pos[k]              = p.pos;
+        vel[k]              = p.vel;
+        radii[k]            = radiusOf(p);
+        invMass[k]          = b == Islands::none || !islands.isAwake(b) ? 0.0 : 1.0 / p.mass;
+        island[k]           = b;
+    }
+    // the fill moved every start to the next cell's, shift them back
+    std::copy_backward(cellStarts.begin(), cellStarts.end() - 1, cellStarts.end());
+    cellStarts[0] = 0;
+}
+
+// calls fn(m, normal, overlap) for every disc overlapping the one in cell order slot k that
+// either of them can move
+template <typename F>
+void PointCollider::forContacts(std::size_t k, F&& fn) const {
+    const std::size_t cx = cells[k] % columns;
+    const std::size_t cy = cells[k] / columns;
+    for (std::size_t y = cy == 0 ? 0 : cy - 1; y <= std::min(cy + 1, rows - 1); ++y) {
+        const std::size_t rowStart = y * columns;
+        const std::size_t first    = cellStarts[rowStart + (cx == 0 ? 0 : cx - 1)];
+        const std::size_t last     = cellStarts[rowStart + std::min(cx + 1, columns - 1) + 1];
+        for (std::size_t m = first; m != last; ++m) {
+            if (m == k || (island[k] != Islands::none && island[m] == island[k]) ||
+                (invMass[k] == 0.0 && invMass[m] == 0.0))
+                continue;
+            const Vec2   diff  = pos[k] - pos[m];
+            const double reach = radii[k] + radii[m];
+            const double dist2 = diff.dot(diff);
+            if (dist2 >= reach * reach || dist2 == 0.0) continue;
+            const double dist = std::sqrt(dist2);
+            fn(m, diff / dist, reach - dist);
+        }
+    }
+}
+
+// Moves the points in cell order slots [begin, end) out of the discs they overlap, writing only
+// to those points so tasks never touch the same point. Each contact is scaled down by the most
+// contacts either side has (like the jacobi spring solve averages) so piles don't overshoot, the
+// same for both sides so momentum is kept.
+void PointCollider::resolve(EntityManager& entities, std::size_t begin, std::size_t end) {
+    for (std::size_t k = begin; k != end; ++k) {
+        if (invMass[k] == 0.0 || touching[k] == 0) continue;
+        Vec2 move{};
+        Vec2 push{};
+        forContacts(k, [&](std::size_t m, const Vec2& normal, double overlap) {
+            const double share   = invMass[k] / (invMass[k] + invMass[m]) /
+                                 static_cast<double>(std::max(touching[k], touching[m]));
+            const double closing = (vel[k] - vel[m]).dot(normal);
+            move += normal * (overlap * share);
+            if (closing < 0) push -= normal * ((1 + restitution) * closing * share);
+        });
+        Point& p = entities.points[order[k]];
+        p.pos += move;
+        p.vel += push;
+    }
+}
+
+void PointCollider::collide(EntityManager& entities, const Islands& islands) {
+    if (!enabled) return;
+    TraceSpan span("point collisions");
+    build(entities, islands);
+    contactCount.store(0, std::memory_order_relaxed);
+    auto count = [&](std::size_t begin, std::size_t end) {
+        std::size_t found = 0;
+        for (std::size_t k = begin; k != end; ++k) {
+            touching[k] = 0;
+            if (cells[k] >= columns * rows) continue;
+            forContacts(k, [&](std::size_t, const Vec2&, double) { ++touching[k]; });
+            found += touching[k];
+        }
+        contactCount.fetch_add(found, std::memory_order_relaxed);
+    };
+    pool.parallelFor(order.size(), grain, count);
+    contacts = contactCount.load(std::memory_order_relaxed) / 2; // seen from both sides
+    if (contacts == 0) return;
+    auto move = [&](std::size_t begin, std::size_t end) { resolve(entities, begin, end); };
+    pool.parallelFor(order.size(), grain, move);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "EntityManager.hpp"
+#include "Fundamentals/Vector2.hpp"
+#include "Islands.hpp"
+#include "WorkerPool.hpp"
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Collisions between the points of different bodies (islands), each point a disc of radius
+// radius * sqrt(mass) so heavier points are bigger at the same density. Points of the same body
+// never collide, their springs keep them apart.
+//
+// The broadphase is a uniform grid over the points' bounds rebuilt every step with a counting
+// sort, the point data is copied into cell order so the neighbour loops read memory in order.
+// The narrowphase is jacobi (every point is moved from the positions at the start) so it can be
+// split over the worker pool without locks. Fixed and sleeping points are obstacles that don't
+// move.
+class PointCollider {
+  private:
+    // per point in cell order
+    std::vector<std::size_t> order; // point index
+    std::vector<std::size_t> cells;
+    std::vector<Vec2>        pos;
+    std::vector<Vec2>        vel;
+    std::vector<double>      radii;
+    std::vector<double>      invMass; // 0 for points that don't move
+    std::vector<std::size_t> island;
+    std::vector<std::size_t> touching; // number of contacts
+
+    std::vector<std::size_t> pointCells; // cell of each point
+    std::vector<std::size_t> cellStarts; // order offsets of each cell (+ end)
+
+    Vec2        origin;
+    double      cellSize = 1.0;
+    std::size_t columns  = 0;
+    std::size_t rows     = 0;
+
+    std::atomic<std::size_t> contactCount = 0;
+    WorkerPool               pool;
+
+    void build(const EntityManager& entities, const Islands& islands);
+    template <typename F>
+    void forContacts(std::size_t k, F&& fn) const;
+    void resolve(EntityManager& entities, std::size_t begin, std::size_t end);
+
+  public:
+    static constexpr std::size_t grain = 2048; // points per narrowphase task
+
+    bool        enabled     = false;
+    double      radius      = 0.05; // of a point of mass 1
+    double      restitution = 0.5;  // fraction of the closing speed kept after a bounce
+    std::size_t contacts    = 0;    // found by the last collide
+
+    double radiusOf(const Point& p) const { return radius * std::sqrt(p.mass); }
+
+    std::size_t threads() const { return pool.threads; }
+    void        setThreads(std::size_t threads) {
+        pool.threads = std::max<std::size_t>(1, threads);
+    }
+
+    // separates overlapping points and bounces their velocities apart, call after moving them
+    void collide(EntityManager& entities, const Islands& islands);
+};
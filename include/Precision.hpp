@@ -0,0 +1,22 @@
+#pragma once
+
+#include "Fundamentals/Vector2.hpp"
+
+// Precision of the solver's working state, picked at compile time with the SIMTEACH_FLOAT cmake
+// option: implicit's conjugate gradient vectors, jacobians and forces, xpbd's multipliers and
+// corrections, the adaptive runge kutta stages and multi-rate's forces.
+//
+// Not covered: the points and springs are the engine's double types (EntityManager only wraps
+// the engine), so the explicit integrator, which is the engine's own step, is the same in both
+// builds. So are the positions written back to the points or differenced against them. Every
+// step is applied to the points in double and scene files read the same into either build. The
+// points' traffic dominates, on a 250k point grid float steps no faster than double.
+#ifdef SIMTEACH_FLOAT
+using Scalar = float;
+#else
+using Scalar = double;
+#endif
+
+using VecS = Vector2<Scalar>;
+
+constexpr const char* precisionLbl = sizeof(Scalar) == sizeof(float) ? "float" : "double";
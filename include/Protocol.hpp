@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Binary protocol of the control socket (see ControlServer.hpp), only needs the standard library
+// so clients can include it alone.
+//
+// Every message is a MessageHeader (payload size and type) followed by the payload, made of
+// native endian fixed size fields and strings (u32 length then the bytes). The client sends
+// requests and gets an Ack for each (a Status for Status), in order. Subscribed clients also get
+// Channels (the column names) and then Frames batches between replies.
+//
+// Requests:
+//   Load        string path (a scene csv, its solver settings are loaded too)
+//   SetGravity  f64
+//   SetPoint    u64 id, u8 PointField, f64 value
+//   SetSpring   u64 id, u8 SpringField, f64 value
+//   SetStep     f64 seconds per step
+//   AddGraph    u8 type (0 point, 1 spring), u64 id, u8 Property, u8 Component (as in Graph.hpp)
+//   Start, Stop
+//   Step        u64 steps (acked once they are done)
+//   Subscribe   u32 steps per sample, f64 max batches per second, u8 energy and momentum channels
+//   Unsubscribe, Status, Shutdown
+// Replies:
+//   Ack         u16 request type, u8 ok, string message
+//   Status      f64 sim time, u64 steps, u8 running, u64 points, u64 springs
+//   Channels    u32 count, count strings
+//   Frames      u32 rows, u32 columns, u64 rows dropped (slow client) since the last batch,
+//               then every row as f64 time and columns f32 values
+
+enum class Request : std::uint16_t {
+    Load = 1,
+    SetGravity,
+    SetPoint,
+    SetSpring,
+    SetStep,
+    AddGraph,
+    Start,
+    Stop,
+    Step,
+    Subscribe,
+    Unsubscribe,
+    Status,
+    Shutdown
+};
+enum class Reply : std::uint16_t { Ack = 100, Status, Channels, Frames };
+
+enum class PointField : std::uint8_t { PosX, PosY, VelX, VelY, Mass, Fixed };
+enum class SpringField : std::uint8_t { SpringConst, NaturalLength, DampFact };
+
+struct MessageHeader {
+    std::uint32_t size; // payload bytes
+    std::uint16_t type;
+    std::uint16_t reserved = 0;
+};
+
+constexpr std::uint32_t maxPayload = 1U << 24; // bigger messages are a broken stream
+
+// appends messages to a buffer
+class MessageWriter {
+  public:
+    explicit MessageWriter(std::vector<std::byte>& out_) : out(out_) {}
+
+    template <typename Type>
+    MessageWriter& begin(Type type) {
+        start = out.size();
+        return put(MessageHeader{0, static_cast<std::uint16_t>(type)});
+    }
+
+    template <typename T>
+        requires(std::is_trivially_copyable_v<T> && !std::is_array_v<T>)
+    MessageWriter& put(const T& value) {
+        const std::size_t at = out.size();
+        out.resize(at + sizeof(T));
+        std::memcpy(out.data() + at, &value, sizeof(T));
+        return *this;
+    }
+
+    MessageWriter& put(std::string_view text) {
+        put(static_cast<std::uint32_t>(text.size()));
+        const std::size_t at = out.size();
+        out.resize(at + text.size());
+        std::memcpy(out.data() + at, text.data(), text.size());
+        return *this;
+    }
+
+    // fills in the payload size
+    void finish() {
+        const auto size = static_cast<std::uint32_t>(out.size() - start - sizeof(MessageHeader));
+        std::memcpy(out.data() + start, &size, sizeof(size));
+    }
+
+  private:
+    std::vector<std::byte>& out;
+    std::size_t             start = 0;
+};
+
+// reads the fields of a payload, ok() turns false on reading past the end
+class MessageReader {
+  public:
+    MessageReader(const std::byte* data_, std::size_t size_) : data(data_), size(size_) {}
+
+    template <typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value{};
+        if (pos + sizeof(T) > size) {
+            valid = false;
+            return value;
+        }
+        std::memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    std::string getString() {
+        const auto length = get<std::uint32_t>();
+        if (!valid || pos + length > size) {
+            valid = false;
+            return {};
+        }
+        std::string text(reinterpret_cast<const char*>(data + pos), length);
+        pos += length;
+        return text;
+    }
+
+    bool ok() const { return valid; }
+
+  private:
+    const std::byte* data;
+    std::size_t      size;
+    std::size_t      pos   = 0;
+    bool             valid = true;
+};
+
+// header of the first complete message in [data, data + size), nullopt if it isn't all there
+// yet (a payload over maxPayload is returned straight away, the stream is broken)
+inline std::optional<MessageHeader> completeMessage(const std::byte* data, std::size_t size) {
+    if (size < sizeof(MessageHeader)) return std::nullopt;
+    MessageHeader header;
+    std::memcpy(&header, data, sizeof(MessageHeader));
+    if (header.size <= maxPayload && size - sizeof(MessageHeader) < header.size)
+        return std::nullopt;
+    return header;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+// what is drawn at a quality level
+struct Quality {
+    float       minSpringPixels; // shorter springs are skipped
+    std::size_t springStride;    // every k-th spring is drawn
+    bool        splats;          // points merged into density splats
+    std::size_t graphStride;     // graphs plot every k-th sample
+    const char* description;
+};
+
+// each level is cheaper to draw than the one before
+constexpr static std::array QualityLevels{
+    Quality{0.0F, 1, false, 1, "Full detail"},
+    Quality{1.0F, 1, false, 1, "Sub pixel springs skipped"},
+    Quality{1.0F, 1, false, 2, "Graphs at half resolution"},
+    Quality{1.0F, 2, false, 2, "Every 2nd spring"},
+    Quality{1.0F, 2, true, 2, "Points as density splats"},
+    Quality{2.0F, 4, true, 4, "Every 4th spring, graphs at quarter resolution"},
+};
+
+// Lowers the drawing detail a level at a time while the time spent drawing a visual frame
+// (smoothed) stays over the target frame time and raises it again once there is plenty of
+// headroom. The sim's share of the frame isn't counted, fewer details can't make it cheaper.
+// Going down reacts faster than going up so the levels don't flicker.
+class QualityGovernor {
+  private:
+    double      smoothed = 0.0; // draw time (s)
+    std::size_t over     = 0;   // frames in a row over the target
+    std::size_t under    = 0;   // frames in a row with headroom
+
+  public:
+    static constexpr std::size_t lowerAfter = 30;  // frames over target before lowering
+    static constexpr std::size_t raiseAfter = 180; // frames with headroom before raising
+    static constexpr double      headroom   = 0.7; // fraction of the target counted as headroom
+
+    bool        enabled   = true;
+    double      targetFps = 60.0;
+    std::size_t level     = 0;
+
+    const Quality& quality() const { return QualityLevels[enabled ? level : 0]; }
+
+    // called every visual frame with the time (s) the last one took to draw
+    void update(double drawTime) {
+        if (!enabled || drawTime <= 0.0) return;
+        smoothed               = smoothed == 0.0 ? drawTime : smoothed * 0.9 + drawTime * 0.1;
+        const double target    = 1.0 / targetFps;
+        over                   = smoothed > target ? over + 1 : 0;
+        under                  = smoothed < target * headroom ? under + 1 : 0;
+        if (over >= lowerAfter && level + 1 < QualityLevels.size()) {
+            ++level;
+            over = 0;
+        } else if (under >= raiseAfter && level != 0) {
+            --level;
+            under = 0;
+        }
+    }
+};
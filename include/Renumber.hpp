@@ -0,0 +1,113 @@
+#pragma once
+
+#include "physics-envy/Engine.hpp"
+#include "physics-envy/Spring.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+// A permutation of the points and springs, new id of each old id
+struct Renumbering {
+    std::vector<PointId>  points;
+    std::vector<SpringId> springs;
+
+    PointId  operator()(PointId old) const { return points[static_cast<std::size_t>(old)]; }
+    SpringId operator()(SpringId old) const { return springs[static_cast<std::size_t>(old)]; }
+
+    bool isIdentity() const {
+        for (std::size_t i = 0; i != points.size(); ++i) {
+            if (static_cast<std::size_t>(points[i]) != i) return false;
+        }
+        for (std::size_t i = 0; i != springs.size(); ++i) {
+            if (static_cast<std::size_t>(springs[i]) != i) return false;
+        }
+        return true;
+    }
+};
+
+// Reverse Cuthill-McKee ordering of the spring graph so points joined by springs end up close
+// together in memory, springs are then sorted by their (new) endpoints so the spring loop walks
+// the points nearly sequentially. Creation order and swap removal otherwise scatter them.
+inline Renumbering cuthillMcKee(const std::vector<Point>&  points,
+                               const std::vector<Spring>& springs) {
+    const std::size_t n = points.size();
+
+    // adjacency in compressed rows
+    std::vector<std::size_t> starts(n + 1, 0);
+    for (const Spring& s: springs) {
+        ++starts[static_cast<std::size_t>(s.p1) + 1];
+        ++starts[static_cast<std::size_t>(s.p2) + 1];
+    }
+    std::partial_sum(starts.begin(), starts.end(), starts.begin());
+    std::vector<std::size_t> adjacent(starts.back());
+    std::vector<std::size_t> next(starts.begin(), starts.end() - 1);
+    for (const Spring& s: springs) {
+        const std::size_t p1 = static_cast<std::size_t>(s.p1);
+        const std::size_t p2 = static_cast<std::size_t>(s.p2);
+        adjacent[next[p1]++] = p2;
+        adjacent[next[p2]++] = p1;
+    }
+    auto degree = [&](std::size_t i) { return starts[i + 1] - starts[i]; };
+
+    // breadth first from the lowest degree unvisited point of each component, neighbours in order
+    // of increasing degree
+    std::vector<std::size_t> byDegree(n);
+    std::iota(byDegree.begin(), byDegree.end(), 0);
+    std::stable_sort(byDegree.begin(), byDegree.end(),
+                     [&](std::size_t a, std::size_t b) { return degree(a) < degree(b); });
+    std::vector<std::size_t> order;
+    order.reserve(n);
+    std::vector<bool> visited(n, false);
+    for (const std::size_t root: byDegree) {
+        if (visited[root]) continue;
+        visited[root] = true;
+        order.push_back(root);
+        for (std::size_t head = order.size() - 1; head != order.size(); ++head) {
+            const std::size_t level = order.size();
+            for (std::size_t j = starts[order[head]]; j != starts[order[head] + 1]; ++j) {
+                if (visited[adjacent[j]]) continue;
+                visited[adjacent[j]] = true;
+                order.push_back(adjacent[j]);
+            }
+            std::stable_sort(order.begin() + static_cast<long>(level), order.end(),
+                             [&](std::size_t a, std::size_t b) { return degree(a) < degree(b); });
+        }
+    }
+
+    Renumbering renumbering;
+    renumbering.points.resize(n);
+    for (std::size_t i = 0; i != n; ++i) renumbering.points[order[n - 1 - i]] = PointId{i};
+
+    // only move points if the bandwidth (furthest apart spring endpoints) improves, so running it
+    // again on an already ordered scene changes nothing
+    auto bandwidth = [&](auto&& id) {
+        std::size_t width = 0;
+        for (const Spring& s: springs) {
+            const std::size_t a = id(s.p1);
+            const std::size_t b = id(s.p2);
+            width               = std::max(width, a > b ? a - b : b - a);
+        }
+        return width;
+    };
+    if (bandwidth([&](PointId p) { return static_cast<std::size_t>(renumbering(p)); }) >=
+        bandwidth([](PointId p) { return static_cast<std::size_t>(p); })) {
+        for (std::size_t i = 0; i != n; ++i) renumbering.points[i] = PointId{i};
+    }
+
+    std::vector<std::size_t> springOrder(springs.size());
+    std::iota(springOrder.begin(), springOrder.end(), 0);
+    auto key = [&](std::size_t s) {
+        const std::size_t a = static_cast<std::size_t>(renumbering(springs[s].p1));
+        const std::size_t b = static_cast<std::size_t>(renumbering(springs[s].p2));
+        return std::pair{std::min(a, b), std::max(a, b)};
+    };
+    std::stable_sort(springOrder.begin(), springOrder.end(),
+                     [&](std::size_t a, std::size_t b) { return key(a) < key(b); });
+    renumbering.springs.resize(springs.size());
+    for (std::size_t i = 0; i != springs.size(); ++i) {
+        renumbering.springs[springOrder[i]] = SpringId{i};
+    }
+    return renumbering;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
+
+enum class RunMode { Realtime, Turbo, Speed, Advance };
+
+constexpr static std::array RunModeLbl{"Realtime", "Turbo", "Speed", "Advance"};
+
+// How much sim time each step of the run loop covers. Realtime follows the wall clock, turbo
+// takes fixed steps as fast as possible, speed follows the wall clock scaled by a multiplier and
+// advance runs turbo until a set amount of sim time has passed. Deterministic makes every mode
+// take fixed steps of turboStep (realtime and speed only decide how many steps are due) so a
+// scene always follows the same trajectory. The serial solver loops run in index order and the
+// parallel parts don't depend on the thread count: the point collision narrowphase is jacobi
+// (each point moved from the positions at the start of the step) and the conservation monitor
+// sums fixed size chunks added in order, so the summation order is fixed too.
+struct RunClock {
+    static constexpr double stepLimit = 0.1; // largest step the settings allow
+
+    RunMode mode          = RunMode::Realtime;
+    double  maxStep       = 0.001;  // realtime and speed never step more than this
+    double  turboStep     = 0.0001; // sim seconds per step in turbo, advance and deterministic
+    double  speed         = 2.0;    // sim seconds per wall second in speed
+    double  advanceTime   = 10.0;   // sim seconds advance runs for
+    bool    deterministic = false;
+    double  stableStep    = std::numeric_limits<double>::infinity(); // every step is clamped to
+
+    // since run start
+    double      simTime  = 0.0;
+    double      wallTime = 0.0;
+    std::size_t steps    = 0;
+
+    void reset() {
+        simTime  = 0.0;
+        wallTime = 0.0;
+        steps    = 0;
+    }
+
+    // whether a step is due, deterministic realtime and speed wait for the wall clock to catch up
+    bool due() const {
+        if (finished()) return false;
+        if (!deterministic) return true;
+        if (mode == RunMode::Realtime) return simTime < wallTime;
+        if (mode == RunMode::Speed) return simTime < wallTime * speed;
+        return true;
+    }
+
+    // the step runs take (at most for realtime and speed)
+    double nominalStep() const {
+        return deterministic || mode == RunMode::Turbo || mode == RunMode::Advance ? turboStep
+                                                                                    : maxStep;
+    }
+
+    // sim seconds to step after wallDelta seconds of wall time since the last step
+    double delta(double wallDelta) const {
+        const double step = std::min(nominalStep(), stableStep);
+        if (deterministic) return step;
+        switch (mode) {
+        case RunMode::Realtime:
+            return std::min(wallDelta, step);
+        case RunMode::Turbo:
+            return step;
+        case RunMode::Speed:
+            return std::min(wallDelta * speed, step);
+        case RunMode::Advance:
+            return std::min(step, advanceTime - simTime);
+        }
+        return 0; // unreachable
+    }
+
+    // advance has covered its sim time (deterministic stops at the step closest to it)
+    bool finished() const {
+        if (mode != RunMode::Advance) return false;
+        return deterministic ? simTime + 0.5 * std::min(turboStep, stableStep) > advanceTime
+                             : simTime >= advanceTime;
+    }
+
+    double ratio() const { return wallTime == 0.0 ? 0.0 : simTime / wallTime; }
+    double stepsPerSecond() const {
+        return wallTime == 0.0 ? 0.0 : static_cast<double>(steps) / wallTime;
+    }
+};
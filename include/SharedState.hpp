@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Layout of the shared memory segment StatePublisher writes the live state into, also for
+// readers in other processes (it only needs the standard library).
+//
+// The segment is a header followed by two slots of slotBytes each. Every publish writes the slot
+// readers aren't pointed at and then points them at it, so a reader has a whole publish interval
+// to read a snapshot in place. Each slot also has a sequence that is odd while it is written and
+// even once it's done (a seqlock), a reader that read too slowly sees it changed and retries.
+//
+// A slot is a SharedSlotHeader, then pointCount SharedPoints, springCount spring tensions
+// (doubles, positive when stretched) and channelCount SharedChannels (the graph values of the
+// latest sample). slotBytes only grows, readers should remap if it outgrows their mapping.
+
+struct SharedStateHeader {
+    static constexpr std::array<char, 8> expectedMagic{'S', 'I', 'M', 'S', 'T', 'A', 'T', '1'};
+
+    std::array<char, 8>                       magic = expectedMagic;
+    std::atomic<std::uint64_t>                slotBytes;
+    std::atomic<std::uint64_t>                latest;    // slot of the newest snapshot
+    std::atomic<std::uint64_t>                published; // snapshots written so far
+    std::array<std::atomic<std::uint64_t>, 2> sequence;  // per slot, odd while being written
+};
+
+struct SharedSlotHeader {
+    double        simTime;
+    std::uint64_t steps;
+    std::uint64_t pointCount;
+    std::uint64_t springCount;
+    std::uint64_t channelCount;
+    std::uint64_t padding = 0;
+};
+
+struct SharedPoint {
+    double posX;
+    double posY;
+    double velX;
+    double velY;
+};
+
+struct SharedChannel {
+    std::array<char, 56> name; // null terminated
+    double               value;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "the seqlock needs address free atomics to work across processes");
+
+inline std::size_t sharedSlotBytes(std::size_t points, std::size_t springs,
+                                   std::size_t channels) {
+    return sizeof(SharedSlotHeader) + points * sizeof(SharedPoint) + springs * sizeof(double) +
+           channels * sizeof(SharedChannel);
+}
+
+// Calls read(slotHeader, points, tensions, channels) on the newest snapshot in a mapped segment
+// of mapped bytes, in place. Returns false (and what read saw must be thrown away) if the
+// snapshot was overwritten while read ran, or the segment outgrew the mapping.
+template <typename F>
+bool readSharedState(const std::byte* segment, std::size_t mapped, F&& read) {
+    const auto& header = *reinterpret_cast<const SharedStateHeader*>(segment);
+    if (header.magic != SharedStateHeader::expectedMagic) return false;
+    const std::uint64_t slot   = header.latest.load(std::memory_order_acquire);
+    const std::uint64_t before = header.sequence[slot].load(std::memory_order_acquire);
+    if (before % 2 != 0) return false;
+    const std::uint64_t slotBytes = header.slotBytes.load(std::memory_order_acquire);
+    if (sizeof(SharedStateHeader) + 2 * slotBytes > mapped) return false;
+
+    const std::byte* data = segment + sizeof(SharedStateHeader) + slot * slotBytes;
+    SharedSlotHeader slotHeader;
+    std::memcpy(&slotHeader, data, sizeof(SharedSlotHeader));
+    if (sharedSlotBytes(slotHeader.pointCount, slotHeader.springCount, slotHeader.channelCount) >
+        slotBytes)
+        return false; // torn, the counts were being written
+    const auto* points   = reinterpret_cast<const SharedPoint*>(data + sizeof(SharedSlotHeader));
+    const auto* tensions = reinterpret_cast<const double*>(points + slotHeader.pointCount);
+    const auto* channels =
+        reinterpret_cast<const SharedChannel*>(tensions + slotHeader.springCount);
+    read(slotHeader, points, tensions, channels);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return header.sequence[slot].load(std::memory_order_relaxed) == before;
+}
@@ -0,0 +1,678 @@
+#include "Solver.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+// -dF/dx of a spring (positive semi definite). The transverse term is clamped at zero when the
+// spring is compressed so the system stays solvable by cg.
+Mat2S<double> stiffness(const Spring& s, const Vec2& n, double length) {
+    const double transverse = std::max(0.0, 1.0 - s.naturalLength / length);
+    return {s.springConst * (transverse * (1 - n.x * n.x) + n.x * n.x),
+            s.springConst * (1 - transverse) * n.x * n.y,
+            s.springConst * (transverse * (1 - n.y * n.y) + n.y * n.y)};
+}
+
+// spring force on p1 (p2 gets the opposite), same model as the engine
+Vec2 springForce(const Spring& s, const Vec2& pos1, const Vec2& pos2, const Vec2& vel1,
+                 const Vec2& vel2) {
+    const Vec2   diff   = pos1 - pos2;
+    const double length = diff.mag();
+    if (length == 0.0) return {};
+    const Vec2 dir = diff / length;
+    return dir *
+           -(s.springConst * (length - s.naturalLength) + s.dampFact * (vel1 - vel2).dot(dir));
+}
+} // namespace
+
+std::size_t Solver::step(Sim& sim, double deltaTime) {
+    islands.refresh(entities);
+    if (sim.gravity != lastGravity) { // a sleeping body at rest is no longer at rest
+        islands.wakeAll();
+        lastGravity = sim.gravity;
+    }
+    grab.apply(entities, islands, deltaTime, integrationStep(deltaTime));
+    switch (integrator) {
+    case Integrator::Explicit:
+        startMove();
+        holdSleeping();
+        sim.simFrame(deltaTime); // the engine's collision is discrete, sweep after it
+        restoreSleeping();
+        collidePolys(entities, islands.activePoints, sweptFrom, polyBounds, surface);
+        collider.collide(entities, islands);
+        islands.update(entities, deltaTime);
+        return 1;
+    case Integrator::Implicit: {
+        accumulated += deltaTime;
+        std::size_t steps = 0;
+        while (accumulated >= stepSize) {
+            implicitStep(sim.gravity, stepSize);
+            islands.update(entities, stepSize);
+            accumulated -= stepSize;
+            ++steps;
+        }
+        return steps;
+    }
+    case Integrator::XPBD: {
+        accumulated += deltaTime;
+        std::size_t steps = 0;
+        while (accumulated >= stepSize) {
+            xpbdStep(sim.gravity, stepSize);
+            islands.update(entities, stepSize);
+            accumulated -= stepSize;
+            steps += substeps;
+        }
+        return steps;
+    }
+    case Integrator::MultiRate: {
+        accumulated += deltaTime;
+        std::size_t steps = 0;
+        while (accumulated >= stepSize) {
+            multiRateStep(sim.gravity, stepSize);
+            islands.update(entities, stepSize);
+            accumulated -= stepSize;
+            steps += std::size_t{1} << (levelStarts.size() - 2); // finest substeps
+        }
+        return steps;
+    }
+    case Integrator::Adaptive: {
+        accumulated += deltaTime;
+        std::size_t steps    = 0;
+        std::size_t rejected = 0;
+        while (accumulated >= adaptiveDt) {
+            const double h = adaptiveDt;
+            if (adaptiveStep(sim.gravity, h)) {
+                islands.update(entities, h);
+                accumulated -= h;
+                ++steps;
+            } else if (++rejected == maxRejections) {
+                // stuck at the smallest step or blown up, drop the time instead of hanging
+                accumulated = 0.0;
+                break;
+            }
+        }
+        return steps;
+    }
+    }
+    return 0; // unreachable
+}
+
+// semi implicit euler over the awake points only
+// the engine steps every point, the sleeping ones are put back after it so they stay at rest
+// like under the other integrators
+void Solver::holdSleeping() {
+    heldPoints.clear();
+    heldPos.clear();
+    heldVel.clear();
+    if (!islands.sleeping) return;
+    for (std::size_t island = 0; island != islands.count(); ++island) {
+        if (islands.isAwake(island)) continue;
+        for (const std::size_t i: islands.points(island)) {
+            heldPoints.push_back(i);
+            heldPos.push_back(entities.points[i].pos);
+            heldVel.push_back(entities.points[i].vel);
+        }
+    }
+}
+
+void Solver::restoreSleeping() {
+    for (std::size_t k = 0; k != heldPoints.size(); ++k) {
+        entities.points[heldPoints[k]].pos = heldPos[k];
+        entities.points[heldPoints[k]].vel = heldVel[k];
+    }
+}
+
+// A = M + sum of spring jacobians over the awake points, fixed points are filtered out (treated
+// as infinite mass)
+void Solver::multiply(const std::vector<VecS>& x, std::vector<VecS>& out) const {
+    const std::vector<Point>& points = entities.points;
+    for (const std::size_t i: islands.activePoints)
+        out[i] = x[i] * static_cast<Scalar>(points[i].mass);
+    for (const std::size_t i: islands.activeSprings) {
+        const std::size_t p1 = static_cast<std::size_t>(entities.springs[i].p1);
+        const std::size_t p2 = static_cast<std::size_t>(entities.springs[i].p2);
+        const bool        free1 = !points[p1].fixed;
+        const bool        free2 = !points[p2].fixed;
+        const VecS f = jacobians[i] * ((free1 ? x[p1] : VecS{}) - (free2 ? x[p2] : VecS{}));
+        if (free1) out[p1] += f;
+        if (free2) out[p2] -= f;
+    }
+}
+
+// backward euler (Baraff & Witkin 98) - solves (M - h dF/dv - h^2 dF/dx) dv = h (F + h dF/dx v)
+// with jacobi preconditioned conjugate gradient without ever building the matrix
+void Solver::implicitStep(double gravity, double h) {
+    TraceSpan                       span("implicit step");
+    std::vector<Point>&             points = entities.points;
+    const std::vector<std::size_t>& active = islands.activePoints;
+    const std::size_t               n      = points.size();
+    startMove();
+    force.resize(n);
+    rhs.resize(n);
+    deltaV.resize(n);
+    residual.resize(n);
+    direction.resize(n);
+    product.resize(n);
+    precon.resize(n);
+    jacobians.resize(entities.springs.size());
+
+    for (const std::size_t i: active) {
+        force[i]  = VecS(Vec2{0, -gravity} * points[i].mass);
+        rhs[i]    = VecS{};
+        deltaV[i] = VecS{};
+        precon[i] = VecS{static_cast<Scalar>(points[i].mass), static_cast<Scalar>(points[i].mass)};
+    }
+
+    // forces and jacobians
+    for (const std::size_t i: islands.activeSprings) {
+        const Spring&     s      = entities.springs[i];
+        const std::size_t p1     = static_cast<std::size_t>(s.p1);
+        const std::size_t p2     = static_cast<std::size_t>(s.p2);
+        const bool        free1  = !points[p1].fixed;
+        const bool        free2  = !points[p2].fixed;
+        const Vec2        diff   = points[p1].pos - points[p2].pos;
+        const double      length = diff.mag();
+        if (length == 0.0) {
+            jacobians[i] = {};
+            continue;
+        }
+        const Vec2          dir    = diff / length;
+        const Vec2          relVel = points[p1].vel - points[p2].vel;
+        const Vec2          f      = springForce(s, points[p1].pos, points[p2].pos, points[p1].vel,
+                                                 points[p2].vel);
+        const Mat2S<double> k      = stiffness(s, dir, length);
+        const VecS kv{k * relVel * (h * h)}; // h^2 dF/dx v term of the right hand side
+        jacobians[i] = Mat2S<double>{h * h * k.xx + h * s.dampFact * dir.x * dir.x,
+                                     h * h * k.xy + h * s.dampFact * dir.x * dir.y,
+                                     h * h * k.yy + h * s.dampFact * dir.y * dir.y}
+                           .as<Scalar>();
+        const VecS diag{jacobians[i].xx, jacobians[i].yy};
+        if (free1) {
+            force[p1] += VecS(f);
+            rhs[p1] -= kv;
+            precon[p1] += diag;
+        }
+        if (free2) {
+            force[p2] -= VecS(f);
+            rhs[p2] += kv;
+            precon[p2] += diag;
+        }
+    }
+
+    // pcg, reductions are summed in double whatever the precision
+    double rhsSq = 0;
+    double rz    = 0;
+    for (const std::size_t i: active) {
+        rhs[i] += force[i] * static_cast<Scalar>(h);
+        residual[i]  = rhs[i];
+        direction[i] = {residual[i].x / precon[i].x, residual[i].y / precon[i].y};
+        rz += residual[i].dot(direction[i]);
+        rhsSq += rhs[i].dot(rhs[i]);
+    }
+    lastCgIters = 0;
+    while (lastCgIters < cgMaxIters && rz > 0) {
+        ++lastCgIters;
+        multiply(direction, product);
+        double dq = 0;
+        for (const std::size_t i: active) dq += direction[i].dot(product[i]);
+        const auto alpha = static_cast<Scalar>(rz / dq);
+        double     resSq = 0;
+        for (const std::size_t i: active) {
+            deltaV[i] += direction[i] * alpha;
+            residual[i] -= product[i] * alpha;
+            resSq += residual[i].dot(residual[i]);
+        }
+        if (resSq <= cgTolerance * cgTolerance * rhsSq) break;
+        double rzNew = 0;
+        for (const std::size_t i: active) {
+            rzNew += residual[i].x * residual[i].x / precon[i].x +
+                     residual[i].y * residual[i].y / precon[i].y;
+        }
+        const auto beta = static_cast<Scalar>(rzNew / rz);
+        rz              = rzNew;
+        for (const std::size_t i: active) {
+            direction[i] = VecS{residual[i].x / precon[i].x, residual[i].y / precon[i].y} +
+                           direction[i] * beta;
+        }
+    }
+
+    for (const std::size_t i: active) {
+        points[i].vel += Vec2(deltaV[i]);
+        points[i].pos += points[i].vel * h;
+    }
+    collidePolys(entities, active, sweptFrom, polyBounds, surface);
+    collider.collide(entities, islands);
+}
+
+// greedy colouring of the awake springs so no two springs of a colour share a point, each colour
+// can then be solved in any order (or in parallel) and still be gauss-seidel between colours
+void Solver::colorSprings() {
+    const std::vector<std::size_t>& springs = islands.activeSprings;
+    std::vector<std::size_t>        springColor(springs.size());
+    std::vector<std::vector<bool>>  used(entities.points.size()); // colours touching each point
+    std::size_t                     colorCount = 0;
+    for (std::size_t i = 0; i != springs.size(); ++i) {
+        const Spring&      s     = entities.springs[springs[i]];
+        std::vector<bool>& used1 = used[static_cast<std::size_t>(s.p1)];
+        std::vector<bool>& used2 = used[static_cast<std::size_t>(s.p2)];
+        std::size_t        c     = 0;
+        while ((c < used1.size() && used1[c]) || (c < used2.size() && used2[c])) ++c;
+        springColor[i] = c;
+        colorCount     = std::max(colorCount, c + 1);
+        used1.resize(std::max(used1.size(), c + 1));
+        used2.resize(std::max(used2.size(), c + 1));
+        used1[c] = true;
+        used2[c] = true;
+    }
+
+    // counting sort by colour
+    colorStarts.assign(colorCount + 1, 0);
+    for (const std::size_t c: springColor) ++colorStarts[c + 1];
+    for (std::size_t c = 0; c != colorCount; ++c) colorStarts[c + 1] += colorStarts[c];
+    colorOrder.resize(springs.size());
+    std::vector<std::size_t> next(colorStarts.begin(), colorStarts.end() - 1);
+    for (std::size_t i = 0; i != springs.size(); ++i) {
+        colorOrder[next[springColor[i]]++] = springs[i];
+    }
+    coloredVersion = islands.version();
+}
+
+// compliant distance constraint (Macklin et al. 2016) with compliance 1 / springConst and
+// damping from dampFact. Jacobi accumulates the moves into deltaV to be averaged.
+void Solver::solveConstraint(std::size_t spring, double h, bool accumulate) {
+    const Spring&     s      = entities.springs[spring];
+    const std::size_t p1     = static_cast<std::size_t>(s.p1);
+    const std::size_t p2     = static_cast<std::size_t>(s.p2);
+    Point&            a      = entities.points[p1];
+    Point&            b      = entities.points[p2];
+    const double      w1     = a.fixed ? 0.0 : 1.0 / a.mass;
+    const double      w2     = b.fixed ? 0.0 : 1.0 / b.mass;
+    const Vec2        diff   = a.pos - b.pos;
+    const double      length = diff.mag();
+    // zero stiffness is infinite compliance, no constraint at all
+    if (w1 + w2 == 0.0 || length == 0.0 || !(s.springConst > 0.0)) return;
+
+    const Vec2   n          = diff / length;
+    const double compliance = 1.0 / (s.springConst * h * h); // alpha tilde
+    const double gamma      = s.dampFact / (s.springConst * h);
+    const double c          = length - s.naturalLength;
+    const double moved      = n.dot((a.fixed ? Vec2{} : a.pos - prevPos[p1]) -
+                                    (b.fixed ? Vec2{} : b.pos - prevPos[p2]));
+    const double dLambda    = (-c - compliance * lambdas[spring] - gamma * moved) /
+                           ((1 + gamma) * (w1 + w2) + compliance);
+    lambdas[spring] += static_cast<Scalar>(dLambda);
+    if (accumulate) {
+        if (!a.fixed) {
+            deltaV[p1] += VecS(n * (w1 * dLambda));
+            ++corrections[p1];
+        }
+        if (!b.fixed) {
+            deltaV[p2] -= VecS(n * (w2 * dLambda));
+            ++corrections[p2];
+        }
+    } else {
+        a.pos += n * (w1 * dLambda);
+        b.pos -= n * (w2 * dLambda);
+    }
+}
+
+// extended position based dynamics, substepped with one iteration each by default
+// ("small steps in physics simulation", Macklin et al. 2019)
+void Solver::xpbdStep(double gravity, double h) {
+    TraceSpan                       span("xpbd step");
+    std::vector<Point>&             points  = entities.points;
+    const std::vector<std::size_t>& active  = islands.activePoints;
+    const std::vector<std::size_t>& springs = islands.activeSprings;
+    if (colorStarts.empty() || coloredVersion != islands.version()) colorSprings();
+    refreshPolyBounds();
+    prevPos.resize(points.size());
+    lambdas.resize(entities.springs.size());
+    deltaV.resize(points.size());
+    corrections.resize(points.size());
+
+    const double subH = h / static_cast<double>(substeps);
+    for (std::size_t sub = 0; sub != substeps; ++sub) {
+        for (const std::size_t i: active) {
+            prevPos[i] = points[i].pos;
+            points[i].vel += Vec2{0, -gravity} * subH;
+            points[i].pos += points[i].vel * subH;
+        }
+        for (const std::size_t i: springs) lambdas[i] = Scalar{};
+
+        for (std::size_t iter = 0; iter != iterations; ++iter) {
+            if (constraintSolve == ConstraintSolve::GaussSeidel) {
+                for (std::size_t c = 0; c + 1 < colorStarts.size(); ++c) {
+                    for (std::size_t i = colorStarts[c]; i != colorStarts[c + 1]; ++i) {
+                        solveConstraint(colorOrder[i], subH, false);
+                    }
+                }
+            } else {
+                for (const std::size_t i: active) {
+                    deltaV[i]      = VecS{};
+                    corrections[i] = 0;
+                }
+                for (const std::size_t i: springs) solveConstraint(i, subH, true);
+                for (const std::size_t i: active) {
+                    if (corrections[i] != 0)
+                        points[i].pos += Vec2(deltaV[i]) / static_cast<double>(corrections[i]);
+                }
+            }
+        }
+
+        for (const std::size_t i: active) points[i].vel = (points[i].pos - prevPos[i]) / subH;
+        collidePolys(entities, active, prevPos, polyBounds, surface);
+        collider.collide(entities, islands);
+    }
+}
+
+// accelerations of the awake points for the given state (fixed points use their own)
+void Solver::accelerations(const std::vector<Vec2>& pos, const std::vector<Vec2>& vel,
+                           double gravity, std::vector<VecS>& acc) const {
+    const std::vector<Point>& points = entities.points;
+    for (const std::size_t i: islands.activePoints) acc[i] = VecS{0, static_cast<Scalar>(-gravity)};
+    for (const std::size_t i: islands.activeSprings) {
+        const Spring&     s     = entities.springs[i];
+        const std::size_t p1    = static_cast<std::size_t>(s.p1);
+        const std::size_t p2    = static_cast<std::size_t>(s.p2);
+        const bool        free1 = !points[p1].fixed;
+        const bool        free2 = !points[p2].fixed;
+        const Vec2        f     = springForce(s, free1 ? pos[p1] : points[p1].pos,
+                                              free2 ? pos[p2] : points[p2].pos,
+                                              free1 ? vel[p1] : Vec2{}, free2 ? vel[p2] : Vec2{});
+        if (free1) acc[p1] += VecS(f / points[p1].mass);
+        if (free2) acc[p2] -= VecS(f / points[p2].mass);
+    }
+}
+
+// one Bogacki-Shampine 3(2) step, the embedded 2nd order solution estimates the error. Returns
+// whether the step was accepted and picks the size of the next one either way.
+bool Solver::adaptiveStep(double gravity, double h) {
+    std::vector<Point>&             points = entities.points;
+    const std::vector<std::size_t>& active = islands.activePoints;
+    const std::size_t               n      = points.size();
+    startMove();
+    for (std::size_t s = 0; s != 4; ++s) {
+        stageVel[s].resize(n);
+        stageAcc[s].resize(n);
+    }
+    tempPos.resize(n);
+    tempVel.resize(n);
+
+    // stage evaluation at y + h * sum(coeffs[s] * k[s])
+    auto stage = [&](std::size_t out, std::array<double, 3> coeffs) {
+        for (const std::size_t i: active) {
+            Vec2 dx{};
+            Vec2 dv{};
+            for (std::size_t s = 0; s != out; ++s) {
+                dx += Vec2(stageVel[s][i]) * coeffs[s];
+                dv += Vec2(stageAcc[s][i]) * coeffs[s];
+            }
+            tempPos[i]       = points[i].pos + dx * h;
+            tempVel[i]       = points[i].vel + dv * h;
+            stageVel[out][i] = VecS(tempVel[i]);
+        }
+        accelerations(tempPos, tempVel, gravity, stageAcc[out]);
+    };
+    stage(0, {});
+    stage(1, {0.5});
+    stage(2, {0.0, 0.75});
+    stage(3, {2.0 / 9.0, 1.0 / 3.0, 4.0 / 9.0}); // 3rd order solution (also k4)
+
+    // error = 3rd order - 2nd order (7/24, 1/4, 1/3, 1/8)
+    constexpr std::array<double, 4> errCoeffs{2.0 / 9.0 - 7.0 / 24.0, 1.0 / 3.0 - 1.0 / 4.0,
+                                              4.0 / 9.0 - 1.0 / 3.0, -1.0 / 8.0};
+    double error = 0.0;
+    for (const std::size_t i: active) {
+        Vec2 ex{};
+        Vec2 ev{};
+        for (std::size_t s = 0; s != 4; ++s) {
+            ex += Vec2(stageVel[s][i]) * errCoeffs[s];
+            ev += Vec2(stageAcc[s][i]) * errCoeffs[s];
+        }
+        const double posError = (ex * h).mag();
+        const double velError = (ev * h).mag();
+        if (!std::isfinite(posError + velError)) { // std::max would skip a nan
+            error = std::numeric_limits<double>::infinity();
+            break;
+        }
+        error = std::max({error, posError, velError});
+    }
+    error /= tolerance;
+
+    if (!std::isfinite(error)) { // blown up, the state is kept and the step shrunk
+        if (blownUpSteps++ == 0) std::cout << "Adaptive step of " << h << " s blew up\n";
+        ++rejectedSteps;
+        adaptiveDt = std::max(h * 0.2, 1e-9);
+        return false;
+    }
+
+    // standard controller with safety factor, never past the explicit stable step
+    const double scale   = error == 0.0 ? 5.0 : std::clamp(0.9 * std::cbrt(1.0 / error), 0.2, 5.0);
+    const double maxStep = std::max(1e-9, std::min(entities.stableStep(), stepSize));
+    adaptiveDt           = std::clamp(h * scale, 1e-9, maxStep);
+    if (error > 1.0) {
+        ++rejectedSteps;
+        return false;
+    }
+    ++acceptedSteps;
+    for (const std::size_t i: active) {
+        points[i].pos = tempPos[i];
+        points[i].vel = tempVel[i];
+    }
+    collidePolys(entities, active, sweptFrom, polyBounds, surface);
+    collider.collide(entities, islands);
+    return true;
+}
+
+// coarsest level (step h / 2^level) at or under the stable step, up to maxRateLevel
+std::size_t Solver::levelFor(double h, double stable) const {
+    std::size_t level = 0;
+    while (level < maxRateLevel && h / static_cast<double>(std::size_t{1} << level) > stable)
+        ++level;
+    return level;
+}
+
+std::optional<double> Solver::finestStep(double runStep) const {
+    if (integrator == Integrator::Explicit) return runStep;
+    if (integrator != Integrator::MultiRate) return std::nullopt;
+    // the finest level assigned, before the first step the one the stiffest point will get
+    const std::size_t finest =
+        levels() != 0 ? levels() - 1 : levelFor(stepSize, entities.stableStep());
+    return stepSize / static_cast<double>(std::size_t{1} << finest);
+}
+
+double Solver::integrationStep(double deltaTime) const {
+    switch (integrator) {
+    case Integrator::Explicit:
+        return deltaTime;
+    case Integrator::XPBD:
+        return stepSize / static_cast<double>(substeps);
+    case Integrator::Adaptive:
+        return adaptiveDt;
+    case Integrator::Implicit:
+    case Integrator::MultiRate:
+        break; // multi-rate moves its slowest points once per step size
+    }
+    return stepSize;
+}
+
+// gives each awake point the coarsest level its springs are stable at, the explicit stable step
+// of the point alone (see StepBound.hpp)
+void Solver::assignRates(double h) {
+    const std::vector<Point>&       points = entities.points;
+    const std::vector<std::size_t>& active = islands.activePoints;
+    const std::size_t               n      = points.size();
+
+    // springs of each point
+    adjStarts.assign(n + 1, 0);
+    for (const std::size_t i: islands.activeSprings) {
+        ++adjStarts[static_cast<std::size_t>(entities.springs[i].p1) + 1];
+        ++adjStarts[static_cast<std::size_t>(entities.springs[i].p2) + 1];
+    }
+    std::partial_sum(adjStarts.begin(), adjStarts.end(), adjStarts.begin());
+    adjSprings.resize(adjStarts.back());
+    std::vector<std::size_t> next(adjStarts.begin(), adjStarts.end() - 1);
+    for (const std::size_t i: islands.activeSprings) {
+        adjSprings[next[static_cast<std::size_t>(entities.springs[i].p1)]++] = i;
+        adjSprings[next[static_cast<std::size_t>(entities.springs[i].p2)]++] = i;
+    }
+
+    rateLevel.assign(n, 0);
+    std::size_t finest = 0;
+    for (const std::size_t i: active) {
+        rateLevel[i] = levelFor(h, entities.stableStep(PointId{i}));
+        finest       = std::max(finest, rateLevel[i]);
+    }
+
+    // counting sort by level
+    levelStarts.assign(finest + 2, 0);
+    for (const std::size_t i: active) ++levelStarts[rateLevel[i] + 1];
+    std::partial_sum(levelStarts.begin(), levelStarts.end(), levelStarts.begin());
+    levelPoints.resize(active.size());
+    next.assign(levelStarts.begin(), levelStarts.end() - 1);
+    for (const std::size_t i: active) levelPoints[next[rateLevel[i]]++] = i;
+    ratedVersion = islands.version();
+}
+
+// Multi-rate symplectic euler with power of two substeps (block time steps). Every point steps
+// 2^level times across h, on the fine substeps that are multiples of its own. Points of a
+// coarser level are read in between their steps by interpolating along their (constant) velocity
+// so the stiff parts see their soft neighbours move smoothly.
+void Solver::multiRateStep(double gravity, double h) {
+    TraceSpan           span("multi-rate step");
+    std::vector<Point>& points = entities.points;
+    if (levelStarts.empty() || ratedVersion != islands.version()) assignRates(h);
+    refreshPolyBounds();
+    const std::size_t finest = levelStarts.size() - 2;
+    const std::size_t ticks  = std::size_t{1} << finest;
+    const double      fineH  = h / static_cast<double>(ticks);
+    force.resize(points.size());
+    pointTick.assign(points.size(), 0);
+
+    // position of point j at fine substep tick
+    auto posAt = [&](std::size_t j, std::size_t tick) {
+        if (points[j].fixed) return points[j].pos;
+        return points[j].pos - points[j].vel * (static_cast<double>(pointTick[j] - tick) * fineH);
+    };
+
+    for (std::size_t tick = 0; tick != ticks; ++tick) {
+        // levels whose step divides tick step now (all of them on tick 0)
+        const std::size_t zeros =
+            tick == 0 ? finest : static_cast<std::size_t>(std::countr_zero(tick));
+        const std::size_t first = levelStarts[finest - std::min(zeros, finest)];
+        const std::size_t last  = levelStarts.back();
+
+        for (std::size_t k = first; k != last; ++k) {
+            const std::size_t i = levelPoints[k];
+            force[i]            = VecS(Vec2{0, -gravity} * points[i].mass);
+            for (std::size_t j = adjStarts[i]; j != adjStarts[i + 1]; ++j) {
+                const Spring&     s     = entities.springs[adjSprings[j]];
+                const std::size_t other = static_cast<std::size_t>(s.p1) == i
+                                              ? static_cast<std::size_t>(s.p2)
+                                              : static_cast<std::size_t>(s.p1);
+                // springForce is the force on its first position argument
+                force[i] += VecS(springForce(s, points[i].pos, posAt(other, tick), points[i].vel,
+                                             points[other].fixed ? Vec2{} : points[other].vel));
+            }
+        }
+        for (std::size_t k = first; k != last; ++k) {
+            const std::size_t i      = levelPoints[k];
+            const std::size_t stride = ticks >> rateLevel[i];
+            const double      hi     = fineH * static_cast<double>(stride);
+            const Vec2        from   = points[i].pos;
+            points[i].vel += Vec2(force[i]) * (hi / points[i].mass);
+            points[i].pos += points[i].vel * hi;
+            pointTick[i] = tick + stride;
+            collide(entities.polys, polyBounds, from, points[i], surface);
+        }
+    }
+    collider.collide(entities, islands);
+}
+
+void Solver::saveSettings(const std::filesystem::path& scene) const {
+    std::ofstream file{settingsPath(scene), std::ios_base::out};
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open solver settings for " + scene.string());
+    }
+    file << std::setprecision(std::numeric_limits<double>::max_digits10);
+    file << "integrator " << getIntegratorLbl(integrator) << "\n";
+    file << "step-size " << stepSize << "\n";
+    file << "substeps " << substeps << "\n";
+    file << "iterations " << iterations << "\n";
+    file << "tolerance " << tolerance << "\n";
+    file << "max-rate-level " << maxRateLevel << "\n";
+    file << "constraint-solve " << ConstraintSolveLbl[static_cast<std::size_t>(constraintSolve)]
+         << "\n";
+    file << "sleeping " << islands.sleeping << "\n";
+    file << "sleep-energy " << islands.sleepEnergy << "\n";
+    file << "sleep-time " << islands.sleepTime << "\n";
+    file << "point-collisions " << collider.enabled << "\n";
+    file << "collision-radius " << collider.radius << "\n";
+    file << "restitution " << collider.restitution << "\n";
+    file << "wall-restitution " << surface.restitution << "\n";
+    file << "wall-friction " << surface.friction << "\n";
+}
+
+// scenes saved before the integrator was selectable have no settings file and run explicit,
+// otherwise only the settings in the file change
+void Solver::loadSettings(const std::filesystem::path& scene) {
+    std::ifstream file{settingsPath(scene)};
+    if (!file.is_open()) {
+        integrator       = Integrator::Explicit;
+        islands.sleeping = false;
+        collider.enabled = false;
+        return;
+    }
+    std::string key;
+    while (file >> key) {
+        if (key == "integrator") {
+            std::string lbl;
+            file >> lbl;
+            auto found = std::find(IntegratorLbl.begin(), IntegratorLbl.end(), lbl);
+            if (found == IntegratorLbl.end())
+                throw std::runtime_error("Unknown integrator in " + scene.string() + ": " + lbl);
+            integrator = static_cast<Integrator>(found - IntegratorLbl.begin());
+        } else if (key == "step-size") {
+            file >> stepSize;
+        } else if (key == "substeps") {
+            file >> substeps;
+        } else if (key == "iterations") {
+            file >> iterations;
+        } else if (key == "tolerance") {
+            file >> tolerance;
+        } else if (key == "max-rate-level") {
+            file >> maxRateLevel;
+        } else if (key == "sleeping") {
+            file >> islands.sleeping;
+        } else if (key == "sleep-energy") {
+            file >> islands.sleepEnergy;
+        } else if (key == "sleep-time") {
+            file >> islands.sleepTime;
+        } else if (key == "point-collisions") {
+            file >> collider.enabled;
+        } else if (key == "collision-radius") {
+            file >> collider.radius;
+        } else if (key == "restitution") {
+            file >> collider.restitution;
+        } else if (key == "wall-restitution") {
+            file >> surface.restitution;
+        } else if (key == "wall-friction") {
+            file >> surface.friction;
+        } else if (key == "constraint-solve") {
+            std::string lbl;
+            file >> lbl;
+            constraintSolve = lbl == ConstraintSolveLbl[1] ? ConstraintSolve::Jacobi
+                                                           : ConstraintSolve::GaussSeidel;
+        } else {
+            std::cout << "Unknown solver setting '" << key << "' ignored\n";
+            std::getline(file, key); // skip value
+        }
+    }
+}
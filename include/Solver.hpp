@@ -0,0 +1,227 @@
+#pragma once
+
+#include "Collision.hpp"
+#include "EntityManager.hpp"
+#include "Fundamentals/Vector2.hpp"
+#include "Grab.hpp"
+#include "Islands.hpp"
+#include "PointCollider.hpp"
+#include "Precision.hpp"
+#include "Sim.hpp"
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+enum class Integrator { Explicit, Implicit, XPBD, Adaptive, MultiRate };
+enum class ConstraintSolve { GaussSeidel, Jacobi };
+
+constexpr static std::array IntegratorLbl{"Explicit", "Implicit", "XPBD", "Adaptive",
+                                          "Multi-rate"};
+constexpr static std::array ConstraintSolveLbl{"Gauss-Seidel", "Jacobi"};
+
+inline std::string getIntegratorLbl(Integrator integrator) {
+    return IntegratorLbl[static_cast<std::size_t>(integrator)];
+}
+
+// symmetric 2x2 matrix (spring jacobians)
+template <typename T>
+struct Mat2S {
+    T xx;
+    T xy;
+    T yy;
+
+    Vector2<T> operator*(const Vector2<T>& v) const {
+        return {xx * v.x + xy * v.y, xy * v.x + yy * v.y};
+    }
+
+    template <typename U>
+    Mat2S<U> as() const {
+        return {static_cast<U>(xx), static_cast<U>(xy), static_cast<U>(yy)};
+    }
+};
+
+// Chooses how the points and springs are stepped forward in time. Explicit is the engines own
+// Sim::simFrame, the rest are implemented here on top of the entities. XPBD treats every spring
+// as a compliant distance constraint instead of a force. Multi-rate steps each point as often as
+// its own springs need. Which integrator a scene uses is saved next to the scene csv (see
+// saveSettings).
+class Solver {
+  private:
+    EntityManager& entities;
+
+    // explicit, the sleeping points' state kept over the engine's step
+    std::vector<std::size_t> heldPoints;
+    std::vector<Vec2>        heldPos;
+    std::vector<Vec2>        heldVel;
+
+    // The integrators' scratch below is in the precision policy's Scalar (see Precision.hpp),
+    // except positions that are written back to the points or differenced against them.
+
+    // implicit scratch (kept between steps to avoid reallocating)
+    std::vector<Mat2S<Scalar>> jacobians; // per spring, -(h * dF/dv + h^2 * dF/dx)
+    std::vector<VecS>          force;     // also multi-rate's
+    std::vector<VecS>          rhs;
+    std::vector<VecS>          deltaV;
+    std::vector<VecS>          residual;
+    std::vector<VecS>          direction;
+    std::vector<VecS>          product;
+    std::vector<VecS>          precon; // jacobi preconditioner (diagonal of the system matrix)
+
+    // xpbd scratch
+    std::vector<Vec2>        prevPos;     // the substep's velocity is the move from them
+    std::vector<Scalar>      lambdas;     // per spring lagrange multipliers
+    std::vector<std::size_t> corrections; // jacobi, number of constraints moving each point
+    std::vector<std::size_t> colorOrder;  // spring indices grouped by colour
+    std::vector<std::size_t> colorStarts; // colorOrder offsets of each colour (+ end)
+
+    // adaptive scratch, runge kutta stages (velocities and accelerations) and the stage state,
+    // which the last stage's becomes the points'
+    std::array<std::vector<VecS>, 4> stageVel;
+    std::array<std::vector<VecS>, 4> stageAcc;
+    std::vector<Vec2>                tempPos;
+    std::vector<Vec2>                tempVel;
+
+    // multi-rate scratch
+    std::vector<std::size_t> rateLevel;    // per point, steps 2^level times per step
+    std::vector<std::size_t> levelPoints;  // active points grouped by level (coarsest first)
+    std::vector<std::size_t> levelStarts;  // levelPoints offsets of each level (+ end)
+    std::vector<std::size_t> pointTick;    // fine substep the points position is at
+    std::vector<std::size_t> adjStarts;    // springs of each point (compressed rows)
+    std::vector<std::size_t> adjSprings;
+    std::size_t              ratedVersion = 0; // islands.version() the levels were built for
+
+    // continuous collision, positions at the start of the move and the polygons' bounds
+    std::vector<Vec2>       sweptFrom;
+    std::vector<PolyBounds> polyBounds;
+
+    double      accumulated    = 0.0; // sim time owed to the fixed step integrators
+    double      lastGravity    = 0.0;
+    std::size_t coloredVersion = 0; // islands.version() the colouring was built for
+
+    void refreshPolyBounds() {
+        if (polyBounds.size() != entities.polys.size())
+            updatePolyBounds(entities.polys, polyBounds);
+    }
+    // remembers where the awake points start a move from
+    void startMove() {
+        refreshPolyBounds();
+        sweptFrom.resize(entities.points.size());
+        for (const std::size_t i: islands.activePoints) sweptFrom[i] = entities.points[i].pos;
+    }
+
+    void holdSleeping();
+    void restoreSleeping();
+
+    void implicitStep(double gravity, double h);
+    void multiply(const std::vector<VecS>& x, std::vector<VecS>& out) const;
+
+    void xpbdStep(double gravity, double h);
+    void colorSprings();
+    void solveConstraint(std::size_t spring, double h, bool accumulate);
+
+    bool adaptiveStep(double gravity, double h);
+    void accelerations(const std::vector<Vec2>& pos, const std::vector<Vec2>& vel, double gravity,
+                       std::vector<VecS>& acc) const;
+
+    void multiRateStep(double gravity, double h);
+    void        assignRates(double h);
+    std::size_t levelFor(double h, double stable) const;
+
+  public:
+    Integrator  integrator  = Integrator::Explicit;
+    double      stepSize    = 0.01; // fixed step (s) of implicit and xpbd, max step of adaptive
+    std::size_t cgMaxIters  = 100;
+    double      cgTolerance = 1e-6;
+    std::size_t lastCgIters = 0; // cg iterations used by the last implicit step
+
+    ConstraintSolve constraintSolve = ConstraintSolve::GaussSeidel;
+    std::size_t     substeps        = 10; // xpbd substeps per step
+    std::size_t     iterations      = 1;  // xpbd constraint iterations per substep
+
+    double      tolerance      = 1e-5; // adaptive, max local error per step (m and m/s)
+    double      adaptiveDt     = 1e-4; // adaptive, size of the next step
+    std::size_t acceptedSteps  = 0;
+    std::size_t rejectedSteps  = 0;
+    std::size_t blownUpSteps   = 0; // adaptive, rejected for a non finite error
+
+    // adaptive, rejections per step() call before giving up on the rest of its time
+    static constexpr std::size_t maxRejections = 100;
+
+    std::size_t maxRateLevel = 8; // multi-rate, finest substep is step size / 2^maxRateLevel
+
+    Islands       islands;
+    PointCollider   collider; // point-point collisions, off by default
+    SurfaceResponse surface;  // how points bounce off the polygons
+    Grab            grab;     // point dragged by the mouse while running
+
+    explicit Solver(EntityManager& entities_) : entities(entities_) {}
+
+    // advances the sim by deltaTime seconds, returns the number of integration steps taken
+    std::size_t step(Sim& sim, double deltaTime);
+
+    // called on run start
+    void reset() {
+        accumulated   = 0.0;
+        adaptiveDt    = 1e-4; // so every run starts the same
+        acceptedSteps = 0;
+        rejectedSteps = 0;
+        blownUpSteps  = 0;
+        colorStarts.clear(); // springs may have been edited
+        levelStarts.clear();
+        islands.invalidate();
+        polyBounds.clear(); // polygons may have been edited
+    }
+
+    // sim time passed to step() that hasn't been stepped yet
+    double owed() const { return accumulated; }
+
+    // smallest step taken on runs of runStep seconds per step, for the integrators whose
+    // stability depends on it (compare with EntityManager::stableStep)
+    std::optional<double> finestStep(double runStep) const;
+
+    // the step the integrator moves the points by on step(deltaTime) calls, the next one for
+    // adaptive
+    double integrationStep(double deltaTime) const;
+
+    // number of independent spring batches xpbd solves (0 until the first xpbd step)
+    std::size_t colors() const { return colorStarts.empty() ? 0 : colorStarts.size() - 1; }
+
+    // multi-rate, number of rate levels (0 until the first step)
+    std::size_t levels() const { return levelStarts.empty() ? 0 : levelStarts.size() - 1; }
+
+    // multi-rate, number of points stepping 2^level times per step
+    std::size_t levelCount(std::size_t level) const {
+        return levelStarts[level + 1] - levelStarts[level];
+    }
+
+    // settings live in a sidecar file next to the scene ("sims/a.csv" -> "sims/a.solver")
+    static std::filesystem::path settingsPath(const std::filesystem::path& scene) {
+        return std::filesystem::path{scene}.replace_extension(".solver");
+    }
+    void saveSettings(const std::filesystem::path& scene) const;
+    // throws std::runtime_error on an unknown integrator (the settings before it are applied)
+    void loadSettings(const std::filesystem::path& scene);
+
+    // takes the settings (not the state) of another solver
+    void copySettings(const Solver& other) {
+        integrator           = other.integrator;
+        stepSize             = other.stepSize;
+        cgMaxIters           = other.cgMaxIters;
+        cgTolerance          = other.cgTolerance;
+        constraintSolve      = other.constraintSolve;
+        substeps             = other.substeps;
+        iterations           = other.iterations;
+        tolerance            = other.tolerance;
+        maxRateLevel         = other.maxRateLevel;
+        islands.sleeping     = other.islands.sleeping;
+        islands.sleepEnergy  = other.islands.sleepEnergy;
+        islands.sleepTime    = other.islands.sleepTime;
+        collider.enabled     = other.collider.enabled;
+        collider.radius      = other.collider.radius;
+        collider.restitution = other.collider.restitution;
+        surface              = other.surface;
+    }
+};
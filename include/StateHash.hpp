@@ -0,0 +1,25 @@
+#pragma once
+
+#include "EntityManager.hpp"
+#include <bit>
+#include <cstdint>
+
+// FNV-1a over the exact bits of every point's position and velocity, equal hashes mean the runs
+// ended in the same state
+inline std::uint64_t stateHash(const EntityManager& entities) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    auto          add  = [&](double value) {
+        const auto bits = std::bit_cast<std::uint64_t>(value);
+        for (std::size_t byte = 0; byte != 8; ++byte) {
+            hash ^= (bits >> (byte * 8)) & 0xFF;
+            hash *= 1099511628211ULL;
+        }
+    };
+    for (const Point& p: entities.points) {
+        add(p.pos.x);
+        add(p.pos.y);
+        add(p.vel.x);
+        add(p.vel.y);
+    }
+    return hash;
+}
@@ -0,0 +1,138 @@
+#include "StatePublisher.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+bool StatePublisher::open(const std::string& name_) {
+    std::cout << "Shared memory publishing (" << name_ << ") needs POSIX shared memory\n";
+    return false;
+}
+
+void StatePublisher::close() {}
+void StatePublisher::map(std::size_t) {}
+void StatePublisher::unmap() {}
+#else
+bool StatePublisher::open(const std::string& name_) {
+    close();
+    name = name_;
+    ::shm_unlink(name.c_str()); // readers of an old segment keep it until they unmap
+    fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd == -1) {
+        std::cout << "Failed to create shared memory segment " << name << "\n";
+        return false;
+    }
+    const std::size_t slotBytes = sharedSlotBytes(0, 0, 0);
+    map(sizeof(SharedStateHeader) + 2 * slotBytes);
+    new (mapped) SharedStateHeader{};
+    header().slotBytes.store(slotBytes, std::memory_order_release);
+    std::cout << "Publishing state to shared memory " << name << "\n";
+    return true;
+}
+
+void StatePublisher::close() {
+    if (fd == -1) return;
+    unmap();
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    fd = -1;
+}
+
+void StatePublisher::map(std::size_t bytes) {
+    unmap();
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+        throw std::runtime_error("Failed to resize shared memory");
+    void* address = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) throw std::runtime_error("Failed to map shared memory");
+    mapped = static_cast<std::byte*>(address);
+    length = bytes;
+}
+
+void StatePublisher::unmap() {
+    if (mapped) ::munmap(mapped, length);
+    mapped = nullptr;
+    length = 0;
+}
+#endif
+
+namespace {
+// marks a slot as being written (odd), it may already be from a resize
+void beginWrite(std::atomic<std::uint64_t>& sequence) {
+    const std::uint64_t s = sequence.load(std::memory_order_relaxed);
+    if (s % 2 == 0) sequence.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void endWrite(std::atomic<std::uint64_t>& sequence) {
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+} // namespace
+
+void StatePublisher::reserve(std::size_t slotBytes) {
+    const std::size_t current = header().slotBytes.load(std::memory_order_relaxed);
+    if (slotBytes <= current) return;
+    // both slots move, readers in the middle of either must retry
+    for (std::atomic<std::uint64_t>& sequence: header().sequence) beginWrite(sequence);
+    const std::size_t grown = std::max(slotBytes, 2 * current);
+    map(sizeof(SharedStateHeader) + 2 * grown);
+    header().slotBytes.store(grown, std::memory_order_release);
+}
+
+void StatePublisher::publish(double simTime, std::size_t steps, const EntityManager& entities,
+                             const GraphManager& graphs) {
+    if (!mapped) return;
+    TraceSpan span("publish state");
+
+    std::size_t channelCount = 0;
+    graphs.forLatest([&](std::string_view, float) { ++channelCount; });
+    const SharedSlotHeader slotHeader{simTime, steps, entities.points.size(),
+                                      entities.springs.size(), channelCount};
+    reserve(sharedSlotBytes(slotHeader.pointCount, slotHeader.springCount, channelCount));
+
+    // the slot readers aren't pointed at
+    SharedStateHeader&          shared    = header();
+    const std::uint64_t         slot      = 1 - shared.latest.load(std::memory_order_relaxed);
+    const std::size_t           slotBytes = shared.slotBytes.load(std::memory_order_relaxed);
+    std::atomic<std::uint64_t>& sequence  = shared.sequence[slot];
+    std::byte*                  data      = mapped + sizeof(SharedStateHeader) + slot * slotBytes;
+    beginWrite(sequence);
+
+    std::memcpy(data, &slotHeader, sizeof(SharedSlotHeader));
+    auto* points = reinterpret_cast<SharedPoint*>(data + sizeof(SharedSlotHeader));
+    for (const Point& p: entities.points) *points++ = {p.pos.x, p.pos.y, p.vel.x, p.vel.y};
+
+    // tension along the spring, the same model as the solver's spring force
+    auto* tensions = reinterpret_cast<double*>(points);
+    for (const Spring& s: entities.springs) {
+        const Point& p1      = entities.points[static_cast<std::size_t>(s.p1)];
+        const Point& p2      = entities.points[static_cast<std::size_t>(s.p2)];
+        const Vec2   diff    = p1.pos - p2.pos;
+        const double dist    = diff.mag();
+        const double closing = dist == 0.0 ? 0.0 : (p1.vel - p2.vel).dot(diff / dist);
+        *tensions++          = s.springConst * (dist - s.naturalLength) + s.dampFact * closing;
+    }
+
+    auto* channels = reinterpret_cast<SharedChannel*>(tensions);
+    graphs.forLatest([&](std::string_view label, float value) {
+        SharedChannel& channel = *channels++;
+        channel.name.fill('\0');
+        std::memcpy(channel.name.data(), label.data(),
+                    std::min(label.size(), channel.name.size() - 1));
+        channel.value = value;
+    });
+
+    endWrite(sequence);
+    shared.latest.store(slot, std::memory_order_release);
+    shared.published.fetch_add(1, std::memory_order_release);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "EntityManager.hpp"
+#include "GraphMananager.hpp"
+#include "SharedState.hpp"
+#include <cstddef>
+#include <string>
+
+// Publishes the live state (points, spring tensions and graph values) into a named POSIX shared
+// memory segment laid out as in SharedState.hpp, so other local processes can read it without
+// any file io. Publishing never waits on readers, a slow reader just retries.
+class StatePublisher {
+  public:
+    StatePublisher() = default;
+    ~StatePublisher() { close(); }
+    StatePublisher(const StatePublisher& other)            = delete;
+    StatePublisher& operator=(const StatePublisher& other) = delete;
+
+    // creates the segment (replacing any left by an earlier run), false if it couldn't
+    bool open(const std::string& name_);
+    void close();
+    bool isOpen() const { return mapped != nullptr; }
+
+    const std::string& segmentName() const { return name; }
+
+    // writes a snapshot, call once per visual frame
+    void publish(double simTime, std::size_t steps, const EntityManager& entities,
+                 const GraphManager& graphs);
+
+  private:
+    SharedStateHeader& header() { return *reinterpret_cast<SharedStateHeader*>(mapped); }
+
+    void map(std::size_t bytes);
+    void unmap();
+    void reserve(std::size_t slotBytes); // grows the slots to hold at least slotBytes
+
+    std::string name;
+    int         fd     = -1;
+    std::byte*  mapped = nullptr;
+    std::size_t length = 0;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "physics-envy/Point.hpp"
+#include "physics-envy/Spring.hpp"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Largest step the explicit (semi implicit euler) integrator is stable at, kept up to date as
+// springs and points are added, removed and edited instead of being recomputed from scratch.
+//
+// Each point sums the stiffness and damping of its springs, counted twice when the other end
+// is free as well (the gershgorin bound on the point's row of M^-1 K). A damped oscillator with
+// w^2 = k / m and g = c / m is stable under semi implicit euler for h^2 w^2 + 2 h g < 4, so the
+// point's limit is 4 / (g + sqrt(g^2 + 4 w^2)). The minimum over the points is kept in a
+// segment tree so an edit costs O(log n).
+class StepBound {
+  private:
+    static constexpr double inf = std::numeric_limits<double>::infinity();
+
+    // what a spring added to the sums of its ends
+    struct Contribution {
+        std::size_t p1;
+        std::size_t p2;
+        double      k1 = 0.0;
+        double      c1 = 0.0;
+        double      k2 = 0.0;
+        double      c2 = 0.0;
+    };
+
+    std::vector<Contribution> contributions; // per spring
+    std::vector<double>       stiffness;     // per point
+    std::vector<double>       damping;
+    std::vector<std::uint8_t> fixed; // when last summed, a change moves the neighbours' sums
+    std::vector<double>       tree;  // min segment tree, point i is the leaf at leaves + i
+    std::size_t               leaves = 0;
+    bool                      dirty  = true;
+
+    static double limit(double k, double c, double mass) {
+        const double omega2 = std::max(0.0, k / mass); // sums can drift just below 0 on removal
+        const double gamma  = std::max(0.0, c / mass);
+        if (omega2 <= 0.0 && gamma <= 0.0) return inf;
+        return 4.0 / (gamma + std::sqrt(gamma * gamma + 4.0 * omega2));
+    }
+
+    double pointLimit(std::size_t point, const std::vector<Point>& points) const {
+        if (points[point].fixed) return inf;
+        return limit(stiffness[point], damping[point], points[point].mass);
+    }
+
+    void setLeaf(std::size_t point, const std::vector<Point>& points) {
+        std::size_t i = leaves + point;
+        tree[i]       = pointLimit(point, points);
+        for (i /= 2; i != 0; i /= 2) tree[i] = std::min(tree[2 * i], tree[2 * i + 1]);
+    }
+
+    Contribution contribution(const Spring& s, const std::vector<Point>& points) const {
+        const std::size_t p1    = static_cast<std::size_t>(s.p1);
+        const std::size_t p2    = static_cast<std::size_t>(s.p2);
+        const bool        free1 = !points[p1].fixed;
+        const bool        free2 = !points[p2].fixed;
+        Contribution      c{p1, p2};
+        if (free1) {
+            c.k1 = s.springConst * (free2 ? 2.0 : 1.0);
+            c.c1 = s.dampFact * (free2 ? 2.0 : 1.0);
+        }
+        if (free2) {
+            c.k2 = s.springConst * (free1 ? 2.0 : 1.0);
+            c.c2 = s.dampFact * (free1 ? 2.0 : 1.0);
+        }
+        return c;
+    }
+
+    void apply(const Contribution& c, double sign) {
+        stiffness[c.p1] += sign * c.k1;
+        damping[c.p1] += sign * c.c1;
+        stiffness[c.p2] += sign * c.k2;
+        damping[c.p2] += sign * c.c2;
+    }
+
+  public:
+    static constexpr double safety = 0.9; // fraction of the bound steps are clamped to
+
+    void rebuild(const std::vector<Point>& points, const std::vector<Spring>& springs) {
+        const std::size_t n = points.size();
+        stiffness.assign(n, 0.0);
+        damping.assign(n, 0.0);
+        fixed.resize(n);
+        for (std::size_t i = 0; i != n; ++i) fixed[i] = points[i].fixed;
+        contributions.clear();
+        for (const Spring& s: springs) {
+            contributions.push_back(contribution(s, points));
+            apply(contributions.back(), 1.0);
+        }
+        leaves = std::bit_ceil(std::max<std::size_t>(n, 1));
+        tree.assign(2 * leaves, inf);
+        for (std::size_t i = 0; i != n; ++i) tree[leaves + i] = pointLimit(i, points);
+        for (std::size_t i = leaves - 1; i != 0; --i)
+            tree[i] = std::min(tree[2 * i], tree[2 * i + 1]);
+        dirty = false;
+    }
+
+    // the scene was replaced (load, renumber), rebuild on the next refresh
+    void invalidate() { dirty = true; }
+
+    // rebuilds if invalidated or the counts no longer match (changed behind its back)
+    void refresh(const std::vector<Point>& points, const std::vector<Spring>& springs) {
+        if (dirty || fixed.size() != points.size() || contributions.size() != springs.size())
+            rebuild(points, springs);
+    }
+
+    void pointAdded(const std::vector<Point>& points) {
+        if (dirty || points.size() > leaves || fixed.size() + 1 != points.size()) {
+            dirty = true; // grow the tree on the next refresh
+            return;
+        }
+        stiffness.push_back(0.0);
+        damping.push_back(0.0);
+        fixed.push_back(points.back().fixed);
+        setLeaf(points.size() - 1, points);
+    }
+
+    // mass or fixed changed
+    void pointEdited(std::size_t point, const std::vector<Point>& points) {
+        if (dirty || point >= fixed.size()) return;
+        if (fixed[point] != points[point].fixed) {
+            dirty = true; // every spring on it counts differently
+            return;
+        }
+        setLeaf(point, points);
+    }
+
+    // added (as the last spring) or spring constant or damping changed
+    void springEdited(std::size_t spring, const std::vector<Point>& points,
+                      const std::vector<Spring>& springs) {
+        if (dirty || spring > contributions.size()) return;
+        if (spring == contributions.size())
+            contributions.emplace_back();
+        else
+            apply(contributions[spring], -1.0);
+        contributions[spring] = contribution(springs[spring], points);
+        apply(contributions[spring], 1.0);
+        setLeaf(contributions[spring].p1, points);
+        setLeaf(contributions[spring].p2, points);
+    }
+
+    // called after the spring was removed by moving the last spring into its place
+    void springRemoved(std::size_t spring, const std::vector<Point>& points) {
+        if (dirty || spring >= contributions.size()) return;
+        const Contribution removed = contributions[spring];
+        contributions[spring]      = contributions.back();
+        contributions.pop_back();
+        apply(removed, -1.0);
+        setLeaf(removed.p1, points);
+        setLeaf(removed.p2, points);
+    }
+
+    // largest stable step (inf with no springs)
+    double bound() const { return tree.empty() ? inf : tree[1]; }
+    double stableStep() const { return safety * bound(); }
+
+    // the same for one point alone (the bound is the minimum of these)
+    double stableStep(std::size_t point) const { return safety * tree[leaves + point]; }
+};
@@ -0,0 +1,187 @@
+#include "Sweep.hpp"
+#include "Sim.hpp"
+#include "Timestamp.hpp"
+#include "Trace.hpp"
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+
+std::size_t Sweep::variants() const {
+    if (random) return samples;
+    std::size_t count = 1;
+    for (const SweepAxis& axis: axes) count *= axis.count;
+    return count;
+}
+
+bool Sweep::start(const EntityManager& entities, const Solver& solver, double gravity) {
+    if (!std::all_of(axes.begin(), axes.end(), [](const SweepAxis& axis) { return axis.valid(); }))
+        return false;
+    cancel();
+    baseEntities.engine = entities.engine;
+    baseEntities.graphs = entities.graphs;
+    baseSolver.copySettings(solver);
+    baseGravity = gravity;
+    runAxes     = axes;
+    results.assign(variants(), SweepResult{});
+    path.clear();
+    next.store(0, std::memory_order_relaxed);
+    completed.store(0, std::memory_order_relaxed);
+    cancelled.store(false, std::memory_order_relaxed);
+    active.store(true, std::memory_order_release);
+
+    coordinator = std::thread([this] {
+        Trace::nameThread("sweep");
+        std::vector<std::thread> pool;
+        for (std::size_t i = 0; i != std::min(threads, results.size()); ++i)
+            pool.emplace_back(&Sweep::worker, this);
+        for (std::thread& thread: pool) thread.join();
+        if (!cancelled.load(std::memory_order_relaxed)) write();
+        active.store(false, std::memory_order_release);
+    });
+    return true;
+}
+
+void Sweep::cancel() {
+    cancelled.store(true, std::memory_order_relaxed);
+    if (coordinator.joinable()) coordinator.join();
+}
+
+// grids count through the axes like digits (the last axis fastest), random sweeps seed each
+// variant on its own so the values don't depend on which worker runs it
+std::vector<double> Sweep::variantValues(std::size_t variant) const {
+    std::vector<double> values(runAxes.size());
+    if (random) {
+        std::mt19937_64 rng(seed + variant);
+        for (std::size_t i = 0; i != runAxes.size(); ++i) {
+            std::uniform_real_distribution<double> dist(runAxes[i].min, runAxes[i].max);
+            values[i] = dist(rng);
+        }
+        return values;
+    }
+    for (std::size_t i = runAxes.size(); i-- != 0;) {
+        const SweepAxis&  axis = runAxes[i];
+        const std::size_t k    = variant % axis.count;
+        variant /= axis.count;
+        values[i] = axis.count == 1 ? axis.min
+                                    : axis.min + (axis.max - axis.min) * static_cast<double>(k) /
+                                                     static_cast<double>(axis.count - 1);
+    }
+    return values;
+}
+
+void Sweep::worker() {
+    Trace::nameThread("sweep worker");
+    while (!cancelled.load(std::memory_order_relaxed)) {
+        const std::size_t variant = next.fetch_add(1, std::memory_order_relaxed);
+        if (variant >= results.size()) return;
+        run(variant);
+        completed.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Sweep::run(std::size_t variant) {
+    TraceSpan     span("sweep variant");
+    EntityManager entities;
+    entities.engine = baseEntities.engine;
+    entities.graphs = baseEntities.graphs;
+    Sim sim(entities, 2.0F);
+    sim.gravity = baseGravity;
+
+    SweepResult& result = results[variant];
+    result.values       = variantValues(variant);
+    for (std::size_t i = 0; i != runAxes.size(); ++i) {
+        const double value = result.values[i];
+        switch (runAxes[i].param) {
+        case SweepParam::SpringConst:
+            for (Spring& s: entities.springs) s.springConst = value;
+            break;
+        case SweepParam::DampFact:
+            for (Spring& s: entities.springs) s.dampFact = value;
+            break;
+        case SweepParam::Mass:
+            for (Point& p: entities.points)
+                if (!p.fixed) p.mass = value;
+            break;
+        case SweepParam::Gravity:
+            sim.gravity = value;
+            break;
+        }
+    }
+
+    Solver solver(entities);
+    solver.copySettings(baseSolver);
+    solver.collider.setThreads(1); // the variants already run in parallel
+    solver.reset();
+
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    result.stats.assign(entities.graphs.size(), SweepStats{inf, -inf, 0.0, 0.0});
+    std::size_t sampleCount = 0;
+    auto        sample      = [&] {
+        for (const Point& p: entities.points) {
+            if (!std::isfinite(p.pos.x) || !std::isfinite(p.pos.y)) {
+                result.exploded = true;
+                return;
+            }
+        }
+        for (std::size_t g = 0; g != entities.graphs.size(); ++g) {
+            const double value = entities.graphs[g].getValue(entities);
+            SweepStats&  stats = result.stats[g];
+            stats.min          = std::min(stats.min, value);
+            stats.max          = std::max(stats.max, value);
+            stats.mean += value;
+            stats.final = value;
+        }
+        ++sampleCount;
+    };
+
+    const auto steps       = static_cast<std::size_t>(std::llround(duration / step));
+    const auto sampleEvery = std::max<std::size_t>(
+        1, static_cast<std::size_t>(std::llround(sampleInterval / step)));
+    for (std::size_t i = 0; i != steps && !result.exploded; ++i) {
+        if (i % sampleEvery == 0) sample();
+        if (i % 1024 == 0 && cancelled.load(std::memory_order_relaxed)) return;
+        solver.step(sim, step);
+    }
+    if (!result.exploded) sample();
+    if (result.exploded) {
+        result.stats.clear(); // the stats of a run that blew up mean nothing
+        return;
+    }
+    for (SweepStats& stats: result.stats) stats.mean /= static_cast<double>(sampleCount);
+}
+
+void Sweep::write() {
+    std::filesystem::create_directory("sweeps");
+    std::filesystem::path file = "sweeps/" + timestamp() + ".csv";
+    file.make_preferred();
+    std::ofstream out{file, std::ios_base::out};
+    if (!out.is_open()) {
+        std::cout << "Failed to write sweep results to " << file << "\n";
+        return;
+    }
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    out << "Variant";
+    for (const SweepAxis& axis: runAxes) out << "," << getSweepParamLbl(axis.param);
+    for (const Graph& g: baseEntities.graphs) {
+        const std::string label = g.getYLabel();
+        out << "," << label << ".Min," << label << ".Max," << label << ".Mean," << label
+            << ".Final";
+    }
+    out << ",Exploded\n";
+    for (std::size_t variant = 0; variant != results.size(); ++variant) {
+        const SweepResult& result = results[variant];
+        out << variant;
+        for (const double value: result.values) out << "," << value;
+        for (const SweepStats& stats: result.stats)
+            out << "," << stats.min << "," << stats.max << "," << stats.mean << ","
+                << stats.final;
+        for (std::size_t g = result.stats.size(); g != baseEntities.graphs.size(); ++g)
+            out << ",,,,"; // exploded, keep the columns lined up
+        out << "," << result.exploded << "\n";
+    }
+    std::cout << "Sweep of " << results.size() << " variants stored at: " << file << "\n";
+    path = file.string();
+}
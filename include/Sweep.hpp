@@ -0,0 +1,115 @@
+#pragma once
+
+#include "EntityManager.hpp"
+#include "Solver.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class SweepParam { SpringConst, DampFact, Mass, Gravity };
+
+constexpr static std::array SweepParamLbl{"Spring const", "Damping", "Mass", "Gravity"};
+
+inline std::string getSweepParamLbl(SweepParam param) {
+    return SweepParamLbl[static_cast<std::size_t>(param)];
+}
+
+// values each parameter can take, the integrators divide by the mass and a negative stiffness or
+// damping adds energy
+struct SweepLimits {
+    double min;
+    double max;
+};
+constexpr static std::array<SweepLimits, 4> SweepParamLimits{
+    {{0.0, 1e9}, {0.0, 1e9}, {1e-6, 1e9}, {-100.0, 100.0}}};
+
+inline SweepLimits getSweepParamLimits(SweepParam param) {
+    return SweepParamLimits[static_cast<std::size_t>(param)];
+}
+
+// a swept parameter, set on every spring (or free point) of a variant. Grids take count evenly
+// spaced values from min to max, random sweeps sample uniformly between them
+struct SweepAxis {
+    SweepParam  param = SweepParam::SpringConst;
+    double      min   = 1000.0;
+    double      max   = 10000.0;
+    std::size_t count = 5;
+
+    // within the parameter's limits and min not above max
+    bool valid() const {
+        const SweepLimits limits = getSweepParamLimits(param);
+        return limits.min <= min && min <= max && max <= limits.max && count != 0;
+    }
+};
+
+// one graph over a variant's run
+struct SweepStats {
+    double min;
+    double max;
+    double mean;
+    double final;
+};
+
+struct SweepResult {
+    std::vector<double>     values;           // per axis
+    std::vector<SweepStats> stats;            // per graph
+    bool                    exploded = false; // a point position stopped being finite
+};
+
+// Runs every variant of a scene (the grid or random set of parameter overrides from the axes)
+// headless for a fixed sim time on a pool of worker threads. Each variant gets its own entities,
+// Sim and Solver so the workers share nothing but the read only base scene. The scene's graphs
+// are the metrics, their min, max, mean and final value are written with the parameters of
+// every variant into one table in sweeps/.
+class Sweep {
+  private:
+    EntityManager            baseEntities;
+    Solver                   baseSolver{baseEntities}; // only holds the settings
+    double                   baseGravity = 0.0;
+    std::vector<SweepAxis>   runAxes; // copy of axes at start
+    std::vector<SweepResult> results;
+    std::string              path;
+    std::thread              coordinator;
+    std::atomic<std::size_t> next      = 0; // next variant to run
+    std::atomic<std::size_t> completed = 0;
+    std::atomic<bool>        active    = false;
+    std::atomic<bool>        cancelled = false;
+
+    std::vector<double> variantValues(std::size_t variant) const;
+    void                run(std::size_t variant);
+    void                worker();
+    void                write();
+
+  public:
+    std::vector<SweepAxis> axes;
+    bool                   random         = false; // sample the axes instead of a grid
+    std::size_t            samples        = 64;    // variants of a random sweep
+    std::uint64_t          seed           = 1;
+    double                 duration       = 5.0;    // sim seconds per variant
+    double                 step           = 0.0001; // sim seconds per solver step
+    double                 sampleInterval = 0.01;   // sim seconds between graph samples
+    std::size_t            threads        = std::max(1U, std::thread::hardware_concurrency());
+
+    Sweep() = default;
+    ~Sweep() { cancel(); }
+    Sweep(const Sweep& other)            = delete;
+    Sweep& operator=(const Sweep& other) = delete;
+
+    // copies the scene and settings then runs the variants in the background, false (and
+    // nothing runs) if an axis isn't valid
+    bool start(const EntityManager& entities, const Solver& solver, double gravity);
+    void cancel();
+
+    bool        isRunning() const { return active.load(std::memory_order_acquire); }
+    std::size_t variants() const;
+    std::size_t done() const { return completed.load(std::memory_order_relaxed); }
+
+    // table of the last finished sweep (empty until one finishes)
+    const std::string& output() const { return path; }
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+
+// current date and time as a filename friendly string eg "2023-10-4_16.2.31"
+inline std::string timestamp() {
+    const std::chrono::time_point     now{std::chrono::system_clock::now()};
+    const std::chrono::year_month_day ymd{std::chrono::floor<std::chrono::days>(now)};
+    const std::chrono::hh_mm_ss       hms{now - std::chrono::floor<std::chrono::days>(now)};
+    std::string name = std::to_string(static_cast<int>(ymd.year())) + "-" +
+                       std::to_string(static_cast<unsigned>(ymd.month())) + "-" +
+                       std::to_string(static_cast<unsigned>(ymd.day())) + "_" +
+                       std::to_string(static_cast<unsigned>(hms.hours().count())) + "." +
+                       std::to_string(static_cast<unsigned>(hms.minutes().count())) + "." +
+                       std::to_string(static_cast<unsigned>(hms.seconds().count()));
+    name.pop_back();
+    std::replace(name.begin(), name.end(), ' ', '-');
+    return name;
+}
@@ -0,0 +1,124 @@
+#include "Trace.hpp"
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+struct TraceEvent {
+    const char*  name;
+    char         phase; // 'X' complete span, 'C' counter
+    std::int64_t start; // ns since capture start
+    std::int64_t dur;   // ns
+    double       value;
+};
+
+// single writer (the owning thread), read by stop() only up to the published count
+struct ThreadBuffer {
+    static constexpr std::size_t capacity = 1 << 16;
+
+    std::unique_ptr<std::array<TraceEvent, capacity>> events =
+        std::make_unique<std::array<TraceEvent, capacity>>();
+    std::atomic<std::size_t> count{0};
+    std::uint32_t            epoch   = 0;
+    std::size_t              dropped = 0;
+    std::size_t              tid;
+    const char*              threadName = nullptr;
+
+    explicit ThreadBuffer(std::size_t tid_) : tid(tid_) {}
+};
+
+// buffers live for the whole program so threads exiting mid capture are still exported
+std::mutex                                 registryMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+ThreadBuffer& localBuffer() {
+    thread_local ThreadBuffer* buffer = [] {
+        std::scoped_lock lock(registryMutex); // once per thread
+        registry.push_back(std::make_unique<ThreadBuffer>(registry.size()));
+        return registry.back().get();
+    }();
+    return *buffer;
+}
+
+void append(std::uint32_t epoch, const TraceEvent& event) {
+    ThreadBuffer& buf = localBuffer();
+    if (buf.epoch != epoch) { // first event of this capture on this thread
+        buf.epoch = epoch;
+        buf.count.store(0, std::memory_order_relaxed);
+        buf.dropped = 0;
+    }
+    const std::size_t i = buf.count.load(std::memory_order_relaxed);
+    if (i == ThreadBuffer::capacity) {
+        ++buf.dropped;
+        return;
+    }
+    (*buf.events)[i] = event;
+    buf.count.store(i + 1, std::memory_order_release); // publish
+}
+} // namespace
+
+void Trace::start() {
+    if (isRecording()) return; // other threads may be reading origin
+    origin = Clock::now();
+    epoch.fetch_add(1, std::memory_order_relaxed);
+    recording.store(true, std::memory_order_release);
+}
+
+void Trace::span(const char* name, Clock::time_point begin, Clock::time_point end) {
+    if (!isRecording()) return;
+    append(epoch.load(std::memory_order_relaxed),
+           {name, 'X', (begin - origin).count(), (end - begin).count(), 0.0});
+}
+
+void Trace::counter(const char* name, double value) {
+    if (!isRecording()) return;
+    append(epoch.load(std::memory_order_relaxed),
+           {name, 'C', (Clock::now() - origin).count(), 0, value});
+}
+
+void Trace::nameThread(const char* name) { localBuffer().threadName = name; }
+
+void Trace::stop(const std::filesystem::path& path) {
+    if (!isRecording()) return;
+    recording.store(false, std::memory_order_release);
+    const std::uint32_t currentEpoch = epoch.load(std::memory_order_relaxed);
+
+    if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path());
+    std::ofstream file{path, std::ios_base::out};
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open trace file: " + path.string());
+    }
+    std::cout << "Storing trace at: " << path << "\n";
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << R"({"name":"process_name","ph":"M","pid":0,"args":{"name":"SimTeach"}})";
+
+    std::scoped_lock lock(registryMutex);
+    for (const std::unique_ptr<ThreadBuffer>& buf: registry) {
+        if (buf->epoch != currentEpoch) continue; // nothing recorded this capture
+        if (buf->threadName)
+            file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buf->tid
+                 << ",\"args\":{\"name\":\"" << buf->threadName << "\"}}";
+        const std::size_t count = buf->count.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i != count; ++i) {
+            const TraceEvent& e = (*buf->events)[i];
+            file << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"" << e.phase
+                 << "\",\"pid\":0,\"tid\":" << buf->tid
+                 << ",\"ts\":" << static_cast<double>(e.start) / 1e3;
+            if (e.phase == 'X')
+                file << ",\"dur\":" << static_cast<double>(e.dur) / 1e3 << "}";
+            else
+                file << ",\"args\":{\"value\":" << e.value << "}}";
+        }
+        if (buf->dropped != 0)
+            std::cout << "Trace buffer full, " << buf->dropped << " events dropped on thread "
+                      << buf->tid << "\n";
+    }
+    file << "\n]}\n";
+}
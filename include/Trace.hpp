@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+// Records spans and counters into per thread buffers and exports them in the chrome trace event
+// json format (open with chrome://tracing or https://ui.perfetto.dev). Each thread only ever
+// appends to its own preallocated buffer so recording takes no locks and does not allocate.
+// All names must be string literals (only the pointer is stored).
+class Trace {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    // acquire pairs with start() publishing origin to the other threads
+    static bool isRecording() { return recording.load(std::memory_order_acquire); }
+
+    // begins a new capture window, discarding anything recorded before (no-op while recording)
+    static void start();
+
+    // ends the capture window and writes it to path (as json)
+    static void stop(const std::filesystem::path& path);
+
+    static void span(const char* name, Clock::time_point begin, Clock::time_point end);
+    static void counter(const char* name, double value);
+
+    // names the calling thread in the exported trace
+    static void nameThread(const char* name);
+
+  private:
+    static inline std::atomic<bool>          recording{false};
+    static inline std::atomic<std::uint32_t> epoch{0};
+    static inline Clock::time_point          origin{}; // only written while not recording
+};
+
+// RAII span covering its own lifetime
+class TraceSpan {
+  public:
+    explicit TraceSpan(const char* name_)
+        : name(Trace::isRecording() ? name_ : nullptr),
+          begin(name ? Trace::Clock::now() : Trace::Clock::time_point{}) {}
+    ~TraceSpan() {
+        if (name) Trace::span(name, begin, Trace::Clock::now());
+    }
+    TraceSpan(const TraceSpan& other)            = delete;
+    TraceSpan& operator=(const TraceSpan& other) = delete;
+
+  private:
+    const char*              name;
+    Trace::Clock::time_point begin;
+};
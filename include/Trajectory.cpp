@@ -0,0 +1,276 @@
+#include "Trajectory.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::filesystem::path& path, bool writable_) : writable(writable_) {
+    file = CreateFileW(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                       FILE_SHARE_READ, nullptr, writable ? CREATE_ALWAYS : OPEN_EXISTING,
+                       FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Failed to open " + path.string());
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    length = static_cast<std::size_t>(size.QuadPart);
+    try {
+        map();
+    } catch (...) { // the destructor won't run
+        unmap();
+        CloseHandle(file);
+        throw;
+    }
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+    CloseHandle(file);
+}
+
+void MappedFile::map() {
+    if (length == 0) return;
+    mapping = CreateFileMappingW(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0,
+                                 nullptr);
+    if (mapping == nullptr) throw std::runtime_error("Failed to map file");
+    mapped = static_cast<std::byte*>(
+        MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, length));
+    if (mapped == nullptr) throw std::runtime_error("Failed to map file");
+}
+
+void MappedFile::unmap() {
+    if (mapped) UnmapViewOfFile(mapped);
+    if (mapping) CloseHandle(mapping);
+    mapped  = nullptr;
+    mapping = nullptr;
+}
+
+void MappedFile::resize(std::size_t bytes) {
+    unmap();
+    LARGE_INTEGER size;
+    size.QuadPart = static_cast<LONGLONG>(bytes);
+    if (!SetFilePointerEx(file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(file))
+        throw std::runtime_error("Failed to resize mapped file");
+    length = bytes;
+    map();
+}
+#else
+MappedFile::MappedFile(const std::filesystem::path& path, bool writable_) : writable(writable_) {
+    fd = writable ? ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)
+                  : ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) throw std::runtime_error("Failed to open " + path.string());
+    struct stat info {};
+    ::fstat(fd, &info);
+    length = static_cast<std::size_t>(info.st_size);
+    try {
+        map();
+    } catch (...) { // the destructor won't run
+        ::close(fd);
+        throw;
+    }
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+    ::close(fd);
+}
+
+void MappedFile::map() {
+    if (length == 0) return;
+    void* address = ::mmap(nullptr, length, writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                           MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) throw std::runtime_error("Failed to map file");
+    mapped = static_cast<std::byte*>(address);
+}
+
+void MappedFile::unmap() {
+    if (mapped) ::munmap(mapped, length);
+    mapped = nullptr;
+}
+
+void MappedFile::resize(std::size_t bytes) {
+    unmap();
+    if (::ftruncate(fd, static_cast<off_t>(bytes)) != 0)
+        throw std::runtime_error("Failed to resize mapped file");
+    length = bytes;
+    map();
+}
+#endif
+
+void TrajectoryRecorder::start(const std::filesystem::path& path, const EntityManager& entities) {
+    stop();
+    if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path());
+    header            = TrajectoryHeader{};
+    header.pointCount = entities.points.size();
+    header.frameCount = 0;
+    header.interval   = interval;
+    header.quantized  = quantize ? 1 : 0;
+    file              = std::make_unique<MappedFile>(path, true);
+    file->resize(sizeof(TrajectoryHeader) + chunkFrames * header.frameSize());
+    std::memcpy(file->data(), &header, sizeof(TrajectoryHeader));
+    nextTime = 0.0;
+    written.store(0, std::memory_order_relaxed);
+    stopping = false;
+    thread   = std::thread(&TrajectoryRecorder::writer, this);
+    std::cout << "Recording trajectory at: " << path << "\n";
+}
+
+void TrajectoryRecorder::stop() {
+    if (!file) return;
+    {
+        std::scoped_lock lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+    file->resize(sizeof(TrajectoryHeader) + header.frameCount * header.frameSize()); // trim
+    file.reset();
+    queue.clear();
+    spare.clear();
+}
+
+void TrajectoryRecorder::record(double time, const EntityManager& entities) {
+    if (!file || entities.points.size() != header.pointCount) return;
+    if (time + interval < nextTime) nextTime = time; // sim time restarted (new run)
+    if (time < nextTime) return;
+    nextTime = time + interval;
+
+    std::vector<std::byte> frame;
+    {
+        std::scoped_lock lock(mutex);
+        if (!spare.empty()) {
+            frame = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+    frame.resize(header.frameSize());
+    std::byte* out = frame.data();
+    std::memcpy(out, &time, sizeof(double));
+    out += sizeof(double);
+    for (const Point& p: entities.points) {
+        for (const double value: {p.pos.x, p.pos.y, p.vel.x, p.vel.y}) {
+            if (header.quantized) {
+                const float f = static_cast<float>(value);
+                std::memcpy(out, &f, sizeof(float));
+                out += sizeof(float);
+            } else {
+                std::memcpy(out, &value, sizeof(double));
+                out += sizeof(double);
+            }
+        }
+    }
+    {
+        std::scoped_lock lock(mutex);
+        queue.push_back(std::move(frame));
+    }
+    wake.notify_one();
+}
+
+void TrajectoryRecorder::writer() {
+    Trace::nameThread("trajectory writer");
+    std::vector<std::vector<std::byte>> writing;
+    while (true) {
+        {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) return; // stopping and everything is written
+            std::swap(writing, queue);
+        }
+        TraceSpan         span("trajectory write");
+        const std::size_t frameSize = header.frameSize();
+        for (std::vector<std::byte>& frame: writing) {
+            const std::size_t end = sizeof(TrajectoryHeader) + (header.frameCount + 1) * frameSize;
+            if (end > file->size()) file->resize(file->size() + chunkFrames * frameSize);
+            std::memcpy(file->data() + end - frameSize, frame.data(), frameSize);
+            ++header.frameCount;
+            std::memcpy(file->data(), &header, sizeof(TrajectoryHeader)); // readable while live
+        }
+        written.store(header.frameCount, std::memory_order_relaxed);
+        std::scoped_lock lock(mutex);
+        for (std::vector<std::byte>& frame: writing) spare.push_back(std::move(frame));
+        writing.clear();
+    }
+}
+
+TrajectoryReader::TrajectoryReader(const std::filesystem::path& path) : file(path, false) {
+    if (file.size() < sizeof(TrajectoryHeader))
+        throw std::runtime_error("Not a trajectory file: " + path.string());
+    std::memcpy(&header, file.data(), sizeof(TrajectoryHeader));
+    if (header.magic != TrajectoryHeader::expectedMagic)
+        throw std::runtime_error("Not a trajectory file: " + path.string());
+    // a recording that was never stopped (crash) has unused chunk space on the end
+    header.frameCount = std::min<std::uint64_t>(
+        header.frameCount, (file.size() - sizeof(TrajectoryHeader)) / header.frameSize());
+}
+
+const std::byte* TrajectoryReader::frameData(std::size_t frame) const {
+    return file.data() + sizeof(TrajectoryHeader) + frame * header.frameSize();
+}
+
+double TrajectoryReader::time(std::size_t frame) const {
+    double t;
+    std::memcpy(&t, frameData(frame), sizeof(double));
+    return t;
+}
+
+std::size_t TrajectoryReader::frameAt(double t) const {
+    std::size_t low  = 0;
+    std::size_t high = frames(); // first frame after t is in [low, high]
+    while (low != high) {
+        const std::size_t mid = (low + high) / 2;
+        if (time(mid) <= t)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low == 0 ? 0 : low - 1;
+}
+
+void TrajectoryReader::read(std::size_t first, std::size_t count, std::vector<Vec2>& pos,
+                            std::vector<Vec2>& vel) const {
+    count = std::min(count, frames() - std::min(first, frames()));
+    pos.resize(count * header.pointCount);
+    vel.resize(count * header.pointCount);
+    std::size_t i = 0;
+    for (std::size_t frame = first; frame != first + count; ++frame) {
+        const std::byte* in = frameData(frame) + sizeof(double);
+        for (std::size_t p = 0; p != header.pointCount; ++p, ++i) {
+            std::array<double, 4> values{};
+            for (double& value: values) {
+                if (header.quantized) {
+                    float f;
+                    std::memcpy(&f, in, sizeof(float));
+                    value = static_cast<double>(f);
+                    in += sizeof(float);
+                } else {
+                    std::memcpy(&value, in, sizeof(double));
+                    in += sizeof(double);
+                }
+            }
+            pos[i] = {values[0], values[1]};
+            vel[i] = {values[2], values[3]};
+        }
+    }
+}
+
+bool TrajectoryReader::load(std::size_t frame, EntityManager& entities) const {
+    if (frame >= frames() || entities.points.size() != header.pointCount) return false;
+    thread_local std::vector<Vec2> pos;
+    thread_local std::vector<Vec2> vel;
+    read(frame, 1, pos, vel);
+    for (std::size_t i = 0; i != pos.size(); ++i) {
+        entities.points[i].pos = pos[i];
+        entities.points[i].vel = vel[i];
+    }
+    return true;
+}
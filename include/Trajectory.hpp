@@ -0,0 +1,123 @@
+#pragma once
+
+#include "EntityManager.hpp"
+#include "Fundamentals/Vector2.hpp"
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A file mapped into memory, writable ones can be grown (which remaps it)
+class MappedFile {
+  public:
+    MappedFile(const std::filesystem::path& path, bool writable_);
+    ~MappedFile();
+    MappedFile(const MappedFile& other)            = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    void             resize(std::size_t bytes);
+    std::byte*       data() { return mapped; }
+    const std::byte* data() const { return mapped; }
+    std::size_t      size() const { return length; }
+
+  private:
+    void map();
+    void unmap();
+
+#ifdef _WIN32
+    void* file    = nullptr;
+    void* mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+    std::byte*  mapped = nullptr;
+    std::size_t length = 0;
+    bool        writable;
+};
+
+// Trajectory files are a header followed by fixed size frames (sim time then pos.x, pos.y, vel.x,
+// vel.y of every point, as floats when quantized) so any frame can be read without the others.
+struct TrajectoryHeader {
+    static constexpr std::array<char, 8> expectedMagic{'S', 'I', 'M', 'T', 'R', 'A', 'J', '1'};
+
+    std::array<char, 8> magic = expectedMagic;
+    std::uint64_t       pointCount;
+    std::uint64_t       frameCount;
+    double              interval; // sim seconds between frames
+    std::uint32_t       quantized;
+    std::uint32_t       padding = 0;
+
+    std::size_t valueSize() const { return quantized ? sizeof(float) : sizeof(double); }
+    std::size_t frameSize() const { return sizeof(double) + pointCount * 4 * valueSize(); }
+};
+
+// Records every point of a run at a fixed sim time interval. The sim thread only copies the
+// points into a spare buffer, a background thread writes them into the mapped file which is grown
+// a chunk of frames at a time.
+class TrajectoryRecorder {
+  public:
+    double interval = 0.01; // sim seconds between frames
+    bool   quantize = true; // store floats instead of doubles
+
+    TrajectoryRecorder() = default;
+    ~TrajectoryRecorder() { stop(); }
+    TrajectoryRecorder(const TrajectoryRecorder& other)            = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder& other) = delete;
+
+    void start(const std::filesystem::path& path, const EntityManager& entities);
+    void stop();
+    bool isRecording() const { return file != nullptr; }
+
+    // queues a frame if interval has passed since the last one
+    void record(double time, const EntityManager& entities);
+
+    std::size_t frames() const { return written.load(std::memory_order_relaxed); }
+
+  private:
+    static constexpr std::size_t chunkFrames = 1024; // file growth
+
+    void writer();
+
+    std::unique_ptr<MappedFile>         file;
+    TrajectoryHeader                    header{};
+    std::thread                         thread;
+    std::mutex                          mutex;
+    std::condition_variable             wake;
+    std::vector<std::vector<std::byte>> queue; // frames waiting to be written
+    std::vector<std::vector<std::byte>> spare; // written buffers for reuse
+    bool                                stopping = false;
+    double                              nextTime = 0.0;
+    std::atomic<std::size_t>            written  = 0;
+};
+
+// Random access to the frames of a recording
+class TrajectoryReader {
+  public:
+    explicit TrajectoryReader(const std::filesystem::path& path);
+
+    std::size_t frames() const { return header.frameCount; }
+    std::size_t points() const { return header.pointCount; }
+    double      time(std::size_t frame) const;
+
+    // last frame at or before time
+    std::size_t frameAt(double time) const;
+
+    // positions and velocities of count frames from first, one after another
+    void read(std::size_t first, std::size_t count, std::vector<Vec2>& pos,
+              std::vector<Vec2>& vel) const;
+
+    // writes a frame into the points, false if the point count doesn't match
+    bool load(std::size_t frame, EntityManager& entities) const;
+
+  private:
+    const std::byte* frameData(std::size_t frame) const;
+
+    MappedFile       file;
+    TrajectoryHeader header;
+};
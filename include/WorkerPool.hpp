@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads kept alive between parallel loops so a loop run every sim step doesn't pay for
+// starting threads. The caller works through the chunks alongside the workers and returns once
+// they are all done. The threads are only started on the first loop big enough to split.
+class WorkerPool {
+  private:
+    using Task = void (*)(void* context, std::size_t begin, std::size_t end);
+
+    std::vector<std::thread> workers;
+    std::mutex               mutex;
+    std::condition_variable  wake;
+    std::condition_variable  finished;
+    std::size_t              generation = 0; // bumped for every loop
+    std::size_t              busy       = 0; // workers still in the current loop
+    bool                     stopping   = false;
+
+    Task                     task    = nullptr;
+    void*                    context = nullptr;
+    std::size_t              count   = 0;
+    std::size_t              grain   = 1;
+    std::atomic<std::size_t> next    = 0; // first index of the next unclaimed chunk
+
+    void work() {
+        for (std::size_t begin = next.fetch_add(grain, std::memory_order_relaxed); begin < count;
+             begin             = next.fetch_add(grain, std::memory_order_relaxed)) {
+            task(context, begin, std::min(begin + grain, count));
+        }
+    }
+
+    void loop(std::size_t seen) {
+        Trace::nameThread("worker");
+        while (true) {
+            std::unique_lock lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            lock.unlock();
+            work();
+            lock.lock();
+            if (--busy == 0) finished.notify_one();
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker: workers) worker.join();
+        workers.clear();
+        stopping = false;
+    }
+
+  public:
+    std::size_t threads = std::max(1U, std::thread::hardware_concurrency()); // including caller
+
+    WorkerPool() = default;
+    ~WorkerPool() { stop(); }
+    WorkerPool(const WorkerPool& other)            = delete;
+    WorkerPool& operator=(const WorkerPool& other) = delete;
+
+    // calls fn(begin, end) over [0, count) in chunks of grain indices, on one thread if there
+    // aren't at least two chunks
+    template <typename F>
+    void parallelFor(std::size_t count_, std::size_t grain_, F& fn) {
+        if (threads <= 1 || count_ < grain_ * 2) {
+            if (count_ != 0) fn(std::size_t{0}, count_);
+            return;
+        }
+        if (workers.size() + 1 != threads) {
+            stop(); // thread count changed, restart them
+            for (std::size_t i = 1; i != threads; ++i)
+                workers.emplace_back(&WorkerPool::loop, this, generation);
+        }
+        {
+            std::lock_guard lock(mutex);
+            task    = [](void* ctx, std::size_t begin, std::size_t end) {
+                (*static_cast<F*>(ctx))(begin, end);
+            };
+            context = &fn;
+            count   = count_;
+            grain   = grain_;
+            next.store(0, std::memory_order_relaxed);
+            busy = workers.size();
+            ++generation;
+        }
+        wake.notify_all();
+        work();
+        std::unique_lock lock(mutex);
+        finished.wait(lock, [&] { return busy == 0; });
+    }
+};
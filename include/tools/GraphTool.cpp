@@ -30,12 +30,14 @@ void GraphTool::DrawGraphs() {
     std::optional<GraphId> newHover = std::nullopt;
     ImGui::Begin("Graphs");
     if (!ImGui::IsWindowCollapsed()) {
+        graphs.assignColumns();
+        graphs.drawChannels();
         for (GraphId i{}; i != static_cast<GraphId>(entities.graphs.size()); ++i) {
             if (selectedG && i == *selectedG)
                 ImPlot::PushStyleColor(ImPlotCol_PlotBg, {0.0F, 1.0F, 0.537F, 0.27F});
             else if (hoveredG && i == *hoveredG)
                 ImPlot::PushStyleColor(ImPlotCol_PlotBg, {0.133F, 0.114F, 0.282F, 0.2F});
-            entities.graphs[static_cast<std::size_t>(i)].draw(i, graphs.tValues);
+            graphs.draw(i);
             if (ImGui::IsItemHovered()) newHover = static_cast<GraphId>(i);
             if ((hoveredG && i == *hoveredG) || (selectedG && i == *selectedG))
                 ImPlot::PopStyleColor();
@@ -125,14 +127,36 @@ void GraphTool::unequip() {
     }
 }
 
+// graph ids don't change, only the point and spring ones need mapping
+void GraphTool::renumber(const Renumbering& renumbering) {
+    if (selectedP) selectedP = renumbering(*selectedP);
+    if (hoveredP) hoveredP = renumbering(*hoveredP);
+    if (selectedS) selectedS = renumbering(*selectedS);
+    if (hoveredS) hoveredS = renumbering(*hoveredS);
+}
+
 void GraphTool::ImTool() {
     // graph data dumping
-    if (graphs.hasDumped || entities.graphs.empty()) ImGui::BeginDisabled();
+    if (graphs.hasDumped || graphs.empty()) ImGui::BeginDisabled();
     if (ImGui::Button("Save data")) {
         graphs.dumpData();
-    } else if (graphs.hasDumped || entities.graphs.empty())
+    } else if (graphs.hasDumped || graphs.empty())
         ImGui::EndDisabled(); // else if to prevent hasdumped change calling enddisabled
 
+    // built in channels
+    if (ImGui::CollapsingHeader("Energy and momentum", ImGuiTreeNodeFlags_OpenOnArrow)) {
+        ConservationMonitor& monitor = graphs.monitor;
+        ImGui::Checkbox("Graph energy and momentum", &monitor.enabled);
+        ImGui::SameLine();
+        HelpMarker("Kinetic, spring and gravity energy and total momentum, measured every frame. "
+                   "Alarms when the total energy rises, or the momentum of a scene without "
+                   "gravity, fixed points or polygons changes, by more than the tolerance.");
+        ImGui_DragDouble("Energy tolerance", &monitor.energyTolerance, 0.001F, 0.0, 1.0, "%.3f",
+                         ImGuiSliderFlags_AlwaysClamp);
+        ImGui_DragDouble("Momentum tolerance", &monitor.momentumTolerance, 0.001F, 0.0, 1.0,
+                         "%.3f", ImGuiSliderFlags_AlwaysClamp);
+    }
+
     // New graph properties
     if (ImGui::CollapsingHeader("New graph properties",
                                 ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_OpenOnArrow)) {
@@ -40,7 +40,10 @@ void PointTool::ImEdit(const sf::Vector2i& mousePixPos) {
         sf::Mouse::setPosition(pointPixPos, window);
     }
 
+    const double mass  = point.mass;
+    const bool   fixed = point.fixed;
     pointInputs(point);
+    if (point.mass != mass || point.fixed != fixed) entities.pointEdited(*selectedP);
 
     // set as tools settings
     if (ImGui::Button("Set as default")) {
@@ -169,6 +172,11 @@ void PointTool::unequip() {
     }
 }
 
+void PointTool::renumber(const Renumbering& renumbering) {
+    if (selectedP) selectedP = renumbering(*selectedP);
+    if (hoveredP) hoveredP = renumbering(*hoveredP);
+}
+
 void PointTool::ImTool() {
     ImGui::SetNextItemWidth(width);
     ImGui_DragDouble("Range", &toolRange, 0.1F, 0.1, 100.0, "%.1f", ImGuiSliderFlags_AlwaysClamp);
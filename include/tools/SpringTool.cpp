@@ -14,7 +14,11 @@ void SpringTool::ImEdit([[maybe_unused]] const sf::Vector2i& mousePixPos) {
         ImGuiCond_Always);
     ImGui::Begin("Edit Spring", NULL, editFlags);
     ImGui::SetWindowSize({-1.0F, -1.0F}, ImGuiCond_Always);
+    const double springConst = spring.springConst;
+    const double dampFact    = spring.dampFact;
     springInputs(spring);
+    if (spring.springConst != springConst || spring.dampFact != dampFact)
+        entities.springEdited(*selectedS);
     ImGui::SetNextItemWidth(100.0F);
     ImGui::InputDouble("Natural length", &spring.naturalLength, 0, 0, "%.3f");
 
@@ -195,6 +199,13 @@ void SpringTool::unequip() {
     }
 }
 
+void SpringTool::renumber(const Renumbering& renumbering) {
+    if (selectedP) selectedP = renumbering(*selectedP);
+    if (hoveredP) hoveredP = renumbering(*hoveredP);
+    if (selectedS) selectedS = renumbering(*selectedS);
+    if (hoveredS) hoveredS = renumbering(*hoveredS);
+}
+
 void SpringTool::ImTool() {
     ImGui::SetNextItemWidth(width);
     ImGui_DragDouble("Range", &toolRange, 0.1F, 0.1, 100.0, "%.1f", ImGuiSliderFlags_AlwaysClamp);
@@ -33,6 +33,7 @@ class Tool {
     virtual void event(const sf::Event& event)                    = 0;
     virtual void unequip()                                        = 0;
     virtual void ImTool()                                         = 0;
+    virtual void renumber(const Renumbering& renumbering)         = 0;
     Tool(const Tool& other)                                       = delete;
     Tool& operator=(const Tool& other)                            = delete;
 
@@ -71,6 +72,7 @@ class GraphTool : public Tool {
     void event(const sf::Event& event) override;
     void unequip() override;
     void ImTool() override;
+    void renumber(const Renumbering& renumbering) override;
 
   private:
     void ImEdit([[maybe_unused]] const sf::Vector2i& mousePixPos) override {}
@@ -81,7 +83,7 @@ class GraphTool : public Tool {
     enum class State { normal, newG, editG };
 
     GraphManager& graphs;
-    Graph         defGraph{PointId{}, Property::Position, Component::x, graphs.graphBuffer};
+    Graph         defGraph{PointId{}, Property::Position, Component::x};
     std::optional<GraphId>  selectedG;
     std::optional<GraphId>  hoveredG;
     std::optional<SpringId> hoveredS;
@@ -98,6 +100,7 @@ class PointTool : public Tool {
     void event(const sf::Event& event) override;
     void unequip() override;
     void ImTool() override;
+    void renumber(const Renumbering& renumbering) override;
 
   private:
     void        removePoint(PointId pos);
@@ -120,6 +123,7 @@ class PolyTool : public Tool {
     void event(const sf::Event& event) override;
     void unequip() override;
     void ImTool() override {}
+    void renumber([[maybe_unused]] const Renumbering& renumbering) override {}
 
   private:
     void ImEdit([[maybe_unused]] const sf::Vector2i& mousePixPos) override {}
@@ -139,6 +143,7 @@ class SpringTool : public Tool {
     void event(const sf::Event& event) override;
     void unequip() override;
     void ImTool() override;
+    void renumber(const Renumbering& renumbering) override;
 
   private:
     void        ImEdit(const sf::Vector2i& mousePixPos) override;